@@ -0,0 +1,83 @@
+#include "bench_common.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+
+#include <X11/Xlib.h>
+
+ullong64 bench_now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ullong64)ts.tv_sec * 1000000000ull + (ullong64)ts.tv_nsec;
+}
+
+pid_t bench_start_xvfb(const char *display_name)
+{
+	pid_t parent = getpid();
+	pid_t pid = fork();
+	if(pid == 0)
+	{
+		// Exits bench_stop_xvfb never sees, like the alarm, take Xvfb along
+		prctl(PR_SET_PDEATHSIG, SIGTERM);
+		if(getppid() != parent)
+			_exit(127);
+
+		freopen("/dev/null", "w", stdout);
+		freopen("/dev/null", "w", stderr);
+		execlp("Xvfb", "Xvfb", display_name, "-screen", "0", "1024x768x24", "-nolisten", "tcp", (char *)NULL);
+		_exit(127);
+	}
+
+	// Wait up to 5 seconds for the server to accept connections
+	for(int i = 0; i < 100 && pid > 0; i++)
+	{
+		Display *display = XOpenDisplay(display_name);
+		if(display != NULL)
+		{
+			XCloseDisplay(display);
+			return pid;
+		}
+		usleep(50000);
+	}
+
+	if(pid > 0)
+		kill(pid, SIGTERM);
+
+	return -1;
+}
+
+void bench_stop_xvfb(pid_t pid)
+{
+	if(pid <= 0)
+		return;
+
+	kill(pid, SIGTERM);
+	waitpid(pid, NULL, 0);
+}
+
+static int compare_ullong(const void *a, const void *b)
+{
+	ullong64 x = *(const ullong64 *)a;
+	ullong64 y = *(const ullong64 *)b;
+	return (x > y) - (x < y);
+}
+
+void bench_sort(ullong64 *samples, uint32 count)
+{
+	qsort(samples, count, sizeof(ullong64), compare_ullong);
+}
+
+d64 bench_percentile_us(const ullong64 *sorted, uint32 count, d64 p)
+{
+	if(count == 0)
+		return 0.0;
+
+	uint32 index = (uint32)(p * (d64)(count - 1));
+	return (d64)sorted[index] / 1000.0;
+}
@@ -0,0 +1,27 @@
+#ifndef BENCH_COMMON_H
+#define BENCH_COMMON_H
+
+#include "lal_defines.h"
+
+#include <sys/types.h>
+
+// Display used when no --display is given, a private Xvfb is started on it
+#define BENCH_XVFB_DISPLAY ":97"
+
+// Maximum latency samples kept per backend
+#define BENCH_MAX_SAMPLES 65536
+
+ullong64 bench_now_ns(void);
+
+// Starts Xvfb on display_name and waits until it accepts connections.
+// Returns its pid, or -1 if it did not come up.
+pid_t bench_start_xvfb(const char *display_name);
+void bench_stop_xvfb(pid_t pid);
+
+// Sorts samples in place
+void bench_sort(ullong64 *samples, uint32 count);
+
+// p in [0, 1] of nanosecond samples sorted by bench_sort, in microseconds
+d64 bench_percentile_us(const ullong64 *sorted, uint32 count, d64 p);
+
+#endif // BENCH_COMMON_H
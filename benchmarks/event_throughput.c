@@ -0,0 +1,278 @@
+#define _GNU_SOURCE
+
+#include "lal/lal_window.h"
+#include "lal/lal_input.h"
+#include "lal_error_list.h"
+#include "bench_common.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#include <X11/Xlib.h>
+#include <X11/keysym.h>
+#include <X11/extensions/XTest.h>
+
+typedef struct Backend
+{
+	const char *name;
+	WindowBackend backend;
+} Backend;
+
+typedef struct Injector
+{
+	const char *display_name;
+	uint32 rate;
+	atomic_int stop;
+	atomic_ullong injected;
+
+	// Monotonic time of the last injected key press, 0 once consumed
+	atomic_ullong press_ns;
+} Injector;
+
+static ullong64 thread_cpu_us(void)
+{
+	struct rusage usage;
+	getrusage(RUSAGE_THREAD, &usage);
+	return (ullong64)usage.ru_utime.tv_sec * 1000000ull + (ullong64)usage.ru_utime.tv_usec
+		+ (ullong64)usage.ru_stime.tv_sec * 1000000ull + (ullong64)usage.ru_stime.tv_usec;
+}
+
+// Backends missing from a pinned build report create_failed
+static const Backend backends[] = {
+	{ "simple", WINDOW_BACKEND_SIMPLE },
+	{ "gl_xlib", WINDOW_BACKEND_GL_XLIB },
+	{ "xcb", WINDOW_BACKEND_XCB },
+};
+
+static void *inject_events(void *arg)
+{
+	Injector *injector = (Injector *)arg;
+
+	Display *display = XOpenDisplay(injector->display_name);
+	if(display == NULL)
+		return NULL;
+
+	uint32 keycode = XKeysymToKeycode(display, XK_a);
+	ullong64 interval = 1000000000ull / injector->rate;
+	ullong64 tick = 0;
+
+	struct timespec next;
+	clock_gettime(CLOCK_MONOTONIC, &next);
+
+	// Keep the pointer, and with it the focus, inside the window
+	XTestFakeMotionEvent(display, -1, 400, 300, CurrentTime);
+	XFlush(display);
+
+	while(!atomic_load(&injector->stop))
+	{
+		sint32 offset = (sint32)(tick % 200);
+
+		switch(tick % 6)
+		{
+			case 0:
+				XTestFakeKeyEvent(display, keycode, True, CurrentTime);
+				XFlush(display);
+				atomic_store(&injector->press_ns, bench_now_ns());
+				break;
+			case 2:
+				XTestFakeKeyEvent(display, keycode, False, CurrentTime);
+				XFlush(display);
+				break;
+			case 4:
+				XTestFakeButtonEvent(display, 1, True, CurrentTime);
+				XFlush(display);
+				break;
+			case 5:
+				XTestFakeButtonEvent(display, 1, False, CurrentTime);
+				XFlush(display);
+				break;
+			default:
+				XTestFakeMotionEvent(display, -1, 300 + offset, 200 + offset, CurrentTime);
+				XFlush(display);
+				break;
+		}
+
+		atomic_fetch_add(&injector->injected, 1);
+		tick++;
+
+		next.tv_nsec += (long)interval;
+		while(next.tv_nsec >= 1000000000L)
+		{
+			next.tv_nsec -= 1000000000L;
+			next.tv_sec++;
+		}
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+	}
+
+	XCloseDisplay(display);
+	return NULL;
+}
+
+static void run_backend(const Backend *backend, const char *display_name, uint32 rate, uint32 seconds)
+{
+	static ullong64 samples[BENCH_MAX_SAMPLES];
+	uint32 sample_count = 0;
+
+	LalEvent events[64];
+
+	PlatformHandler plat;
+	if(lal_window_create(&plat, backend->backend, "LAL Bench", 0, 0, 800, 600) != OK)
+	{
+		printf("{\"backend\":\"%s\",\"status\":\"create_failed\"}\n", backend->name);
+		fflush(stdout);
+		return;
+	}
+
+	lal_window_run(&plat);
+
+	// Injection includes motion, which windows don't select by default
+	set_input_features(&plat, INPUT_FEATURE_DEFAULT | INPUT_FEATURE_MOUSE_MOTION);
+
+	Injector injector;
+	injector.display_name = display_name;
+	injector.rate = rate;
+	atomic_init(&injector.stop, 0);
+	atomic_init(&injector.injected, 0);
+	atomic_init(&injector.press_ns, 0);
+
+	pthread_t thread;
+	pthread_create(&thread, NULL, inject_events, &injector);
+
+	ullong64 processed = 0;
+	b8 key_was_down = FALSE;
+	ullong64 cpu_start = thread_cpu_us();
+	ullong64 start = bench_now_ns();
+	ullong64 deadline = start + (ullong64)seconds * 1000000000ull;
+
+	while(bench_now_ns() < deadline)
+	{
+		uint32 count = lal_poll_events(&plat, events, 64);
+
+		// Only what the injector sent, not the expose, focus or resize events
+		for(uint32 i = 0; i < count; i++)
+		{
+			if(events[i].type == LAL_EVENT_KEY || events[i].type == LAL_EVENT_BUTTON
+					|| events[i].type == LAL_EVENT_MOTION)
+				processed++;
+		}
+
+		b8 key_down = is_key_down(KEY_A);
+		if(key_down && !key_was_down)
+		{
+			ullong64 press = atomic_exchange(&injector.press_ns, 0);
+			if(press != 0 && sample_count < BENCH_MAX_SAMPLES)
+				samples[sample_count++] = bench_now_ns() - press;
+		}
+		key_was_down = key_down;
+	}
+
+	ullong64 elapsed = bench_now_ns() - start;
+	ullong64 cpu = thread_cpu_us() - cpu_start;
+
+	atomic_store(&injector.stop, 1);
+	pthread_join(thread, NULL);
+
+	lal_window_shutdown(&plat);
+
+	bench_sort(samples, sample_count);
+
+	d64 elapsed_s = (d64)elapsed / 1e9;
+	printf("{\"backend\":\"%s\",\"status\":\"ok\",\"rate\":%u,\"seconds\":%.3f,"
+		"\"injected\":%llu,\"processed\":%llu,\"events_per_sec\":%.1f,"
+		"\"latency_us\":{\"samples\":%u,\"p50\":%.1f,\"p90\":%.1f,\"p99\":%.1f,\"max\":%.1f},"
+		"\"cpu_us_per_event\":%.3f}\n",
+		backend->name, rate, elapsed_s,
+		atomic_load(&injector.injected), processed, (d64)processed / elapsed_s,
+		sample_count,
+		bench_percentile_us(samples, sample_count, 0.50),
+		bench_percentile_us(samples, sample_count, 0.90),
+		bench_percentile_us(samples, sample_count, 0.99),
+		bench_percentile_us(samples, sample_count, 1.0),
+		processed ? (d64)cpu / (d64)processed : 0.0);
+	fflush(stdout);
+}
+
+static void usage(const char *program)
+{
+	fprintf(stderr, "usage: %s [--backend simple|gl_xlib|xcb] [--rate events/s] [--seconds n] [--display :n]\n", program);
+}
+
+int main(int argc, char **argv)
+{
+	const char *only_backend = NULL;
+	const char *display_name = NULL;
+	uint32 rate = 2000;
+	uint32 seconds = 5;
+
+	for(int i = 1; i < argc; i++)
+	{
+		if(strcmp(argv[i], "--backend") == 0 && i + 1 < argc)
+			only_backend = argv[++i];
+		else if(strcmp(argv[i], "--rate") == 0 && i + 1 < argc)
+			rate = (uint32)strtoul(argv[++i], NULL, 10);
+		else if(strcmp(argv[i], "--seconds") == 0 && i + 1 < argc)
+			seconds = (uint32)strtoul(argv[++i], NULL, 10);
+		else if(strcmp(argv[i], "--display") == 0 && i + 1 < argc)
+			display_name = argv[++i];
+		else
+		{
+			usage(argv[0]);
+			return FAILED;
+		}
+	}
+
+	if(rate == 0 || seconds == 0)
+	{
+		usage(argv[0]);
+		return FAILED;
+	}
+
+	// The injector thread runs its own connection next to the backend's
+	XInitThreads();
+
+	pid_t xvfb = -1;
+	if(display_name == NULL)
+	{
+		display_name = BENCH_XVFB_DISPLAY;
+		xvfb = bench_start_xvfb(display_name);
+		if(xvfb < 0)
+		{
+			fprintf(stderr, "ERROR: Failed to start Xvfb on %s.\n", display_name);
+			return WINDOW_ERROR;
+		}
+	}
+	setenv("DISPLAY", display_name, 1);
+
+	Display *display = XOpenDisplay(display_name);
+	int event_base, error_base, major, minor;
+	if(display == NULL || !XTestQueryExtension(display, &event_base, &error_base, &major, &minor))
+	{
+		fprintf(stderr, "ERROR: XTest extension is not available on %s.\n", display_name);
+		if(display != NULL)
+			XCloseDisplay(display);
+		bench_stop_xvfb(xvfb);
+		return FAILED;
+	}
+	XCloseDisplay(display);
+
+	// A backend stuck in the event loop must not hang the suite
+	alarm(seconds * 3 * (uint32)(sizeof(backends) / sizeof(backends[0])) + 30);
+
+	for(size_t i = 0; i < sizeof(backends) / sizeof(backends[0]); i++)
+	{
+		if(only_backend != NULL && strcmp(only_backend, backends[i].name) != 0)
+			continue;
+
+		run_backend(&backends[i], display_name, rate, seconds);
+	}
+
+	bench_stop_xvfb(xvfb);
+
+	return 0;
+}
@@ -0,0 +1,265 @@
+#include "lal/lal_window.h"
+#include "lal_error_list.h"
+#include "bench_common.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+
+#include <X11/Xlib.h>
+#include <X11/extensions/XRes.h>
+
+// Iterations run before the baseline is taken, so one-time setup like
+// loading the GL driver does not count as growth
+#define CHURN_WARMUP 16
+
+typedef struct Backend
+{
+	const char *name;
+	WindowBackend backend;
+} Backend;
+
+typedef struct ResourceUsage
+{
+	sllong64 rss_kb;
+	sllong64 fds;
+	sllong64 x_clients;
+	sllong64 x_resources;
+} ResourceUsage;
+
+// Backends missing from a pinned build report create_failed
+static const Backend backends[] = {
+	{ "simple", WINDOW_BACKEND_SIMPLE },
+	{ "gl_xlib", WINDOW_BACKEND_GL_XLIB },
+	{ "xcb", WINDOW_BACKEND_XCB },
+};
+
+static sllong64 read_rss_kb(void)
+{
+	FILE *file = fopen("/proc/self/statm", "r");
+	if(file == NULL)
+		return -1;
+
+	ullong64 size = 0;
+	ullong64 resident = 0;
+	if(fscanf(file, "%llu %llu", &size, &resident) != 2)
+		resident = 0;
+
+	fclose(file);
+	return (sllong64)(resident * (ullong64)sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static sllong64 count_fds(void)
+{
+	DIR *dir = opendir("/proc/self/fd");
+	if(dir == NULL)
+		return -1;
+
+	sllong64 count = 0;
+	struct dirent *entry;
+	while((entry = readdir(dir)) != NULL)
+	{
+		if(entry->d_name[0] != '.')
+			count++;
+	}
+
+	closedir(dir);
+
+	// Minus the descriptor of the listing itself
+	return count - 1;
+}
+
+// Server side view through X-Resource, from a connection that stays open
+static void count_x_resources(Display *monitor, ResourceUsage *usage)
+{
+	usage->x_clients = -1;
+	usage->x_resources = -1;
+
+	if(monitor == NULL)
+		return;
+
+	// Let the server finish with connections closed so far
+	XSync(monitor, False);
+
+	sint32 client_count = 0;
+	XResClient *clients = NULL;
+	if(!XResQueryClients(monitor, &client_count, &clients))
+		return;
+
+	usage->x_clients = client_count;
+	usage->x_resources = 0;
+
+	for(sint32 i = 0; i < client_count; i++)
+	{
+		sint32 type_count = 0;
+		XResType *types = NULL;
+		if(!XResQueryClientResources(monitor, clients[i].resource_base, &type_count, &types))
+			continue;
+
+		for(sint32 t = 0; t < type_count; t++)
+			usage->x_resources += types[t].count;
+
+		XFree(types);
+	}
+
+	XFree(clients);
+}
+
+static void sample_usage(Display *monitor, ResourceUsage *usage)
+{
+	usage->rss_kb = read_rss_kb();
+	usage->fds = count_fds();
+	count_x_resources(monitor, usage);
+}
+
+static void print_latency(const char *name, ullong64 *samples, uint32 count)
+{
+	bench_sort(samples, count);
+	printf("\"%s\":{\"p50\":%.1f,\"p90\":%.1f,\"p99\":%.1f,\"max\":%.1f}", name,
+		bench_percentile_us(samples, count, 0.50),
+		bench_percentile_us(samples, count, 0.90),
+		bench_percentile_us(samples, count, 0.99),
+		bench_percentile_us(samples, count, 1.0));
+}
+
+static void run_backend(const Backend *backend, Display *monitor, uint32 iterations)
+{
+	static ullong64 create_samples[BENCH_MAX_SAMPLES];
+	static ullong64 destroy_samples[BENCH_MAX_SAMPLES];
+	uint32 sample_count = 0;
+	uint32 failures = 0;
+	ullong64 x_errors = 0;
+
+	ResourceUsage before;
+	ResourceUsage after;
+	sample_usage(monitor, &before);
+
+	for(uint32 i = 0; i < CHURN_WARMUP + iterations; i++)
+	{
+		if(i == CHURN_WARMUP)
+			sample_usage(monitor, &before);
+
+		PlatformHandler plat;
+
+		// Creation is asynchronous, the checkpoint makes the latency include
+		// the server side work and catches errors of this window
+		ullong64 start = bench_now_ns();
+		if(lal_window_create(&plat, backend->backend, "LAL Churn", 0, 0, 320, 240) != OK)
+		{
+			if(i == 0)
+			{
+				printf("{\"backend\":\"%s\",\"status\":\"create_failed\"}\n", backend->name);
+				fflush(stdout);
+				return;
+			}
+
+			failures++;
+			continue;
+		}
+
+		lal_window_run(&plat);
+		check_x_errors(&plat);
+		ullong64 created = bench_now_ns();
+
+		x_errors += get_x_error_count(&plat);
+
+		lal_window_shutdown(&plat);
+		ullong64 destroyed = bench_now_ns();
+
+		if(i >= CHURN_WARMUP && sample_count < BENCH_MAX_SAMPLES)
+		{
+			create_samples[sample_count] = created - start;
+			destroy_samples[sample_count] = destroyed - created;
+			sample_count++;
+		}
+	}
+
+	sample_usage(monitor, &after);
+
+	printf("{\"backend\":\"%s\",\"status\":\"ok\",\"iterations\":%u,\"failures\":%u,\"x_errors\":%llu,",
+		backend->name, iterations, failures, x_errors);
+	print_latency("create_us", create_samples, sample_count);
+	printf(",");
+	print_latency("destroy_us", destroy_samples, sample_count);
+
+	// -1 means the value could not be measured
+	printf(",\"growth\":{\"rss_kb\":%lld,\"fds\":%lld,\"x_clients\":%lld,\"x_resources\":%lld}}\n",
+		after.rss_kb - before.rss_kb,
+		after.fds - before.fds,
+		before.x_clients < 0 ? -1 : after.x_clients - before.x_clients,
+		before.x_resources < 0 ? -1 : after.x_resources - before.x_resources);
+	fflush(stdout);
+}
+
+static void usage(const char *program)
+{
+	fprintf(stderr, "usage: %s [--backend simple|gl_xlib|xcb] [--iterations n] [--display :n]\n", program);
+}
+
+int main(int argc, char **argv)
+{
+	const char *only_backend = NULL;
+	const char *display_name = NULL;
+	uint32 iterations = 1000;
+
+	for(int i = 1; i < argc; i++)
+	{
+		if(strcmp(argv[i], "--backend") == 0 && i + 1 < argc)
+			only_backend = argv[++i];
+		else if(strcmp(argv[i], "--iterations") == 0 && i + 1 < argc)
+			iterations = (uint32)strtoul(argv[++i], NULL, 10);
+		else if(strcmp(argv[i], "--display") == 0 && i + 1 < argc)
+			display_name = argv[++i];
+		else
+		{
+			usage(argv[0]);
+			return FAILED;
+		}
+	}
+
+	if(iterations == 0)
+	{
+		usage(argv[0]);
+		return FAILED;
+	}
+
+	pid_t xvfb = -1;
+	if(display_name == NULL)
+	{
+		display_name = BENCH_XVFB_DISPLAY;
+		xvfb = bench_start_xvfb(display_name);
+		if(xvfb < 0)
+		{
+			fprintf(stderr, "ERROR: Failed to start Xvfb on %s.\n", display_name);
+			return WINDOW_ERROR;
+		}
+	}
+	setenv("DISPLAY", display_name, 1);
+
+	// Without X-Resource only client side growth is reported
+	Display *monitor = XOpenDisplay(display_name);
+	int event_base, error_base;
+	if(monitor != NULL && !XResQueryExtension(monitor, &event_base, &error_base))
+	{
+		fprintf(stderr, "WARNING: X-Resource extension is not available on %s.\n", display_name);
+		XCloseDisplay(monitor);
+		monitor = NULL;
+	}
+
+	for(size_t i = 0; i < sizeof(backends) / sizeof(backends[0]); i++)
+	{
+		if(only_backend != NULL && strcmp(only_backend, backends[i].name) != 0)
+			continue;
+
+		run_backend(&backends[i], monitor, iterations);
+	}
+
+	if(monitor != NULL)
+		XCloseDisplay(monitor);
+
+	bench_stop_xvfb(xvfb);
+
+	return 0;
+}
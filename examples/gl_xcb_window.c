@@ -7,8 +7,9 @@ int main()
 {
 	PlatformHandler plat;
 
-    if(create_xcb_window(
+    if(lal_window_create(
         &plat,
+        WINDOW_BACKEND_XCB,
         "XCB Window",
         0,
         0,
@@ -16,17 +17,17 @@ int main()
         600) != OK)
         return WINDOW_ERROR;
 
-    run_xcb_window(&plat);
+    lal_window_run(&plat);
     
 	while(is_platform_running(&plat))
     {   
-        process_xcb_events(&plat);
+        lal_window_process_events(&plat);
 
         if(is_key_down(KEY_ESCAPE))
 			set_platform_running(&plat, FALSE);
     }
 
-    shutdown_xcb_window(&plat);
+    lal_window_shutdown(&plat);
 	
 	return 0;
 }
@@ -7,23 +7,27 @@ int main()
 {
 	PlatformHandler plat;
 
-	if(create_simple_window(
+	if(lal_window_create(
 			&plat,
+			WINDOW_BACKEND_SIMPLE,
+			"Simple Window",
 			0,
 			0,
 			800,
 			600) != OK)
 		return WINDOW_ERROR;
 
+	lal_window_run(&plat);
+
 	while(is_platform_running(&plat))
 	{
-		process_simple_window_events(&plat);		
+		lal_window_process_events(&plat);		
 
 		if(is_key_down(KEY_ESCAPE))
 			set_platform_running(&plat, FALSE);
 	}
 
-	shutdown_simple_window(&plat);
+	lal_window_shutdown(&plat);
 
 	return 0;
 }
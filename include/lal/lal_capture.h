@@ -0,0 +1,54 @@
+#ifndef LAL_CAPTURE_H
+#define LAL_CAPTURE_H
+
+#include "lal_defines.h"
+#include "lal/lal_window.h"
+
+#if LPLATFORM_LINUX
+
+#define LAL_CAPTURE_MAX_DEPTH 8
+
+typedef struct LalCaptureFrame
+{
+	// BGRA, 8 bits per channel, bottom row first as GL reads it.
+	// Only valid during the callback.
+	const uchar8 *pixels;
+	uint32 width;
+	uint32 height;
+	uint32 stride;
+
+	// Counts every frame since lal_capture_start, dropped ones leave a gap
+	ullong64 index;
+
+	// CLOCK_MONOTONIC when the frame was read back, right before its swap
+	ullong64 timestamp_ns;
+} LalCaptureFrame;
+
+typedef void (*LalCaptureCallback)(void *user_data, const LalCaptureFrame *frame);
+
+// Reads back the back buffer of a gl_xlib or xcb window every frame into a
+// ring of depth pixel pack buffers. Each readback is fenced and handed to
+// callback depth - 1 frames later, once the fence has signalled, so the
+// GL thread never waits on glReadPixels. A frame is dropped instead when
+// its buffer is still busy.
+//
+// Capture calls must be made on the thread holding the GL context: inside
+// the render callback while a render thread runs, the event thread otherwise.
+// callback also runs there.
+b8 lal_capture_start(PlatformHandler *platform_handler, uint32 depth, LalCaptureCallback callback, void *user_data);
+
+// Hands the frames still in flight to the callback and frees the buffers.
+// Window shutdown calls it as well.
+void lal_capture_stop(PlatformHandler *platform_handler);
+
+// Queues the readback of the current back buffer and delivers the frames
+// that are ready. The render thread and the built-in redraw call it before
+// each swap, only needed when the application swaps on its own.
+void lal_capture_frame(PlatformHandler *platform_handler, uint32 width, uint32 height);
+
+// Frames skipped because the ring was full
+ullong64 lal_capture_dropped(PlatformHandler *platform_handler);
+
+#endif // LPLATFORM_LINUX
+
+#endif // LAL_CAPTURE_H
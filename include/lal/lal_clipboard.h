@@ -0,0 +1,60 @@
+#ifndef LAL_CLIPBOARD_H
+#define LAL_CLIPBOARD_H
+
+#include "lal_defines.h"
+#include "lal/lal_window.h"
+
+#include <stddef.h>
+
+#if LPLATFORM_LINUX
+
+typedef enum LalSelection
+{
+	LAL_SELECTION_CLIPBOARD,
+	LAL_SELECTION_PRIMARY,
+	LAL_SELECTION_COUNT
+} LalSelection;
+
+typedef enum LalClipboardStatus
+{
+	// data holds the next piece of the selection
+	LAL_CLIPBOARD_CHUNK,
+
+	// The transfer is complete, no data
+	LAL_CLIPBOARD_DONE,
+
+	// The owner refused or there is no owner, no data
+	LAL_CLIPBOARD_FAILED
+} LalClipboardStatus;
+
+// Runs inside the event poll for every chunk, data points into the X reply
+// and is only valid during the call
+typedef void (*LalClipboardReceiver)(void *user_data, LalSelection selection, LalClipboardStatus status,
+	const uchar8 *data, size_t size);
+
+// The data given to lal_clipboard_set is no longer referenced
+typedef void (*LalClipboardRelease)(void *user_data, const uchar8 *data, size_t size);
+
+// Asks the owner of selection for UTF-8 text and returns. The reply is read
+// by the event poll, large selections arrive through INCR one property at a
+// time, so the whole selection is never buffered. One request per selection
+// can be pending.
+b8 lal_clipboard_request(PlatformHandler *platform_handler, LalSelection selection,
+	LalClipboardReceiver receiver, void *user_data);
+
+// Stops delivering a pending request, the receiver is not called again
+void lal_clipboard_cancel(PlatformHandler *platform_handler, LalSelection selection);
+
+// Takes ownership of selection with UTF-8 text. data is not copied: it is
+// sent straight from the caller's memory, in INCR chunks when larger than a
+// request, and must stay valid until release is called. That happens once
+// another client takes the selection and the last transfer has finished.
+b8 lal_clipboard_set(PlatformHandler *platform_handler, LalSelection selection, const uchar8 *data, size_t size,
+	LalClipboardRelease release, void *user_data);
+
+// Gives up ownership of selection
+void lal_clipboard_clear(PlatformHandler *platform_handler, LalSelection selection);
+
+#endif // LPLATFORM_LINUX
+
+#endif // LAL_CLIPBOARD_H
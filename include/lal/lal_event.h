@@ -0,0 +1,108 @@
+#ifndef LAL_EVENT_H
+#define LAL_EVENT_H
+
+#include "lal_defines.h"
+
+typedef enum LalEventType
+{
+	LAL_EVENT_NONE,
+	LAL_EVENT_KEY,
+	LAL_EVENT_BUTTON,
+	LAL_EVENT_MOTION,
+	LAL_EVENT_WHEEL,
+	LAL_EVENT_RESIZE,
+	LAL_EVENT_FOCUS,
+	LAL_EVENT_EXPOSE,
+	LAL_EVENT_CLOSE,
+	LAL_EVENT_RELATIVE_MOTION,
+	LAL_EVENT_TOUCH_BEGIN,
+	LAL_EVENT_TOUCH_UPDATE,
+	LAL_EVENT_TOUCH_END,
+	LAL_EVENT_MONITORS_CHANGED
+} LalEventType;
+
+// Backend independent event record, filled into caller owned arrays.
+// Kept at 16 bytes so four records share a cache line.
+typedef struct LalEvent
+{
+	uint32 type;
+
+	// Server timestamp in milliseconds. Events without one carry the
+	// timestamp of the last event that had it.
+	uint32 time;
+
+	// device is the XInput 2 source device with INPUT_FEATURE_PER_DEVICE,
+	// 0 for core events
+	union
+	{
+		struct
+		{
+			ushort16 key;
+			b8 pressed;
+			b8 repeat;
+			ushort16 device;
+		} key;
+
+		struct
+		{
+			uchar8 button;
+			b8 pressed;
+			sshort16 x;
+			sshort16 y;
+			ushort16 device;
+		} button;
+
+		struct
+		{
+			sshort16 x;
+			sshort16 y;
+			ushort16 device;
+		} motion;
+
+		// Steps, positive is up and right
+		struct
+		{
+			sshort16 dx;
+			sshort16 dy;
+			sshort16 x;
+			sshort16 y;
+		} wheel;
+
+		struct
+		{
+			ushort16 width;
+			ushort16 height;
+		} resize;
+
+		struct
+		{
+			b8 focused;
+		} focus;
+
+		// Unaccelerated device motion while the pointer is locked
+		struct
+		{
+			f32 dx;
+			f32 dy;
+		} relative_motion;
+
+		// id stays the same from begin to end, see get_touch_table for slots
+		struct
+		{
+			uint32 id;
+			sshort16 x;
+			sshort16 y;
+		} touch;
+
+		// The table of lal_get_monitors was refreshed
+		struct
+		{
+			uint32 generation;
+			sint32 window_monitor;
+		} monitors;
+	};
+} LalEvent;
+
+_Static_assert(sizeof(LalEvent) == 16, "LalEvent must stay 16 bytes");
+
+#endif // LAL_EVENT_H
@@ -0,0 +1,83 @@
+#ifndef LAL_GAMEPAD_H
+#define LAL_GAMEPAD_H
+
+#include "lal_defines.h"
+
+#if LPLATFORM_LINUX
+
+#define LAL_MAX_GAMEPADS 8
+
+// Named after the position on the pad, SOUTH is A on Xbox layouts.
+// Plain joysticks report their buttons in order from SOUTH.
+typedef enum LalGamepadButton
+{
+	LAL_GAMEPAD_BUTTON_SOUTH,
+	LAL_GAMEPAD_BUTTON_EAST,
+	LAL_GAMEPAD_BUTTON_WEST,
+	LAL_GAMEPAD_BUTTON_NORTH,
+	LAL_GAMEPAD_BUTTON_LEFT_SHOULDER,
+	LAL_GAMEPAD_BUTTON_RIGHT_SHOULDER,
+	LAL_GAMEPAD_BUTTON_BACK,
+	LAL_GAMEPAD_BUTTON_START,
+	LAL_GAMEPAD_BUTTON_GUIDE,
+	LAL_GAMEPAD_BUTTON_LEFT_STICK,
+	LAL_GAMEPAD_BUTTON_RIGHT_STICK,
+	LAL_GAMEPAD_BUTTON_DPAD_UP,
+	LAL_GAMEPAD_BUTTON_DPAD_DOWN,
+	LAL_GAMEPAD_BUTTON_DPAD_LEFT,
+	LAL_GAMEPAD_BUTTON_DPAD_RIGHT,
+	LAL_GAMEPAD_BUTTON_COUNT
+} LalGamepadButton;
+
+typedef enum LalGamepadAxis
+{
+	LAL_GAMEPAD_AXIS_LEFT_X,
+	LAL_GAMEPAD_AXIS_LEFT_Y,
+	LAL_GAMEPAD_AXIS_RIGHT_X,
+	LAL_GAMEPAD_AXIS_RIGHT_Y,
+	LAL_GAMEPAD_AXIS_LEFT_TRIGGER,
+	LAL_GAMEPAD_AXIS_RIGHT_TRIGGER,
+	LAL_GAMEPAD_AXIS_COUNT
+} LalGamepadAxis;
+
+// State of one pad
+typedef struct LalGamepad
+{
+	// Bit per LalGamepadButton in this application frame and the one before.
+	// They move once per event poll or process call, like the keys. A press
+	// released within one frame still reads as down for that frame.
+	uint32 buttons;
+	uint32 previous_buttons;
+
+	// Updated on every evdev frame (SYN_REPORT). Sticks -32767..32767 with up and left negative, triggers 0..32767.
+	// Values inside the device's flat zone read 0.
+	sshort16 axes[LAL_GAMEPAD_AXIS_COUNT];
+
+	b8 connected;
+} LalGamepad;
+
+// Opens every gamepad in /dev/input and watches it for hotplug. Reads are
+// dispatched from the window event poll, see add_wait_source.
+b8 lal_gamepad_initialize();
+void lal_gamepad_shutdown();
+
+// Opens one device, returns its pad index or -1. Paths that are not evdev
+// devices, like a pipe replaying a recorded stream of struct input_event,
+// are read with default axis ranges.
+sint32 lal_gamepad_open(const char *path);
+
+// Reads everything pending without blocking. Only needed when the window
+// event poll is not running, e.g. with the blocking Xlib process calls.
+void lal_gamepad_poll();
+
+// epoll descriptor covering all pads and hotplug, readable when there is input
+sint32 lal_gamepad_fd();
+
+const LalGamepad *lal_gamepad_get(uint32 pad);
+b8 lal_gamepad_is_button_down(uint32 pad, LalGamepadButton button);
+b8 lal_gamepad_was_button_down(uint32 pad, LalGamepadButton button);
+sshort16 lal_gamepad_axis(uint32 pad, LalGamepadAxis axis);
+
+#endif // LPLATFORM_LINUX
+
+#endif // LAL_GAMEPAD_H
@@ -0,0 +1,67 @@
+#ifndef LAL_GL_H
+#define LAL_GL_H
+
+#include "lal_defines.h"
+
+#if LPLATFORM_LINUX
+
+#include <GL/gl.h>
+#include <GL/glx.h>
+
+// GLX entry points needed to create and present a context.
+// Resolved eagerly by lal_gl_load(), an entry stays NULL if the driver lacks it.
+// E(return type, name, parameter list)
+#define LAL_GL_EAGER_FUNCS(E) \
+	E(GLXContext, glXCreateContextAttribsARB, (Display *dpy, GLXFBConfig config, GLXContext share_context, Bool direct, const int *attrib_list)) \
+	E(void, glXSwapIntervalEXT, (Display *dpy, GLXDrawable drawable, int interval)) \
+	E(Bool, glXMakeContextCurrent, (Display *dpy, GLXDrawable draw, GLXDrawable read, GLXContext ctx)) \
+	E(void, glXSwapBuffers, (Display *dpy, GLXDrawable drawable))
+
+// GL entry points used by rendering code.
+// Patched into the table by lal_gl_load(), which the windows call before
+// any render thread starts. Until then, or if the driver lacks one, the
+// entry is a stub that resolves the real function on each call.
+// R(return type, name, parameter list, argument list) for functions returning a value
+// V(name, parameter list, argument list) for functions returning void
+#define LAL_GL_LAZY_FUNCS(R, V) \
+	R(const GLubyte *, glGetString, (GLenum name), (name)) \
+	V(glViewport, (GLint x, GLint y, GLsizei width, GLsizei height), (x, y, width, height)) \
+	V(glClearColor, (GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha), (red, green, blue, alpha)) \
+	V(glClear, (GLbitfield mask), (mask)) \
+	V(glFlush, (void), ()) \
+	V(glFinish, (void), ()) \
+	V(glReadBuffer, (GLenum src), (src)) \
+	V(glReadPixels, (GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, void *pixels), (x, y, width, height, format, type, pixels)) \
+	V(glGenBuffers, (GLsizei n, GLuint *buffers), (n, buffers)) \
+	V(glDeleteBuffers, (GLsizei n, const GLuint *buffers), (n, buffers)) \
+	V(glBindBuffer, (GLenum target, GLuint buffer), (target, buffer)) \
+	V(glBufferData, (GLenum target, GLsizeiptr size, const void *data, GLenum usage), (target, size, data, usage)) \
+	R(void *, glMapBufferRange, (GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access), (target, offset, length, access)) \
+	R(GLboolean, glUnmapBuffer, (GLenum target), (target)) \
+	R(GLsync, glFenceSync, (GLenum condition, GLbitfield flags), (condition, flags)) \
+	R(GLenum, glClientWaitSync, (GLsync sync, GLbitfield flags, GLuint64 timeout), (sync, flags, timeout)) \
+	V(glDeleteSync, (GLsync sync), (sync))
+
+#define LAL_GL_EAGER_MEMBER(ret, name, params) ret (APIENTRYP name) params;
+#define LAL_GL_LAZY_MEMBER(ret, name, params, args) ret (APIENTRYP name) params;
+#define LAL_GL_LAZY_VOID_MEMBER(name, params, args) void (APIENTRYP name) params;
+
+typedef struct LalGLDispatch
+{
+	LAL_GL_EAGER_FUNCS(LAL_GL_EAGER_MEMBER)
+	LAL_GL_LAZY_FUNCS(LAL_GL_LAZY_MEMBER, LAL_GL_LAZY_VOID_MEMBER)
+} LalGLDispatch;
+
+// Process wide dispatch table, call through it instead of the GL/GLX symbols
+extern LalGLDispatch lal_gl;
+
+// Resolves the GLX and GL entries, only the first call does any work
+b8 lal_gl_load();
+
+typedef void (*LalGLProc)(void);
+
+LalGLProc lal_gl_get_proc_address(const char *name);
+
+#endif // LPLATFORM_LINUX
+
+#endif // LAL_GL_H
@@ -399,7 +399,82 @@ typedef enum Keys
     KEY_RBRACKET = 0xDD,
 } Keys;
 
+#define LAL_MAX_TOUCHES 16
+
+typedef enum TouchPhase
+{
+	TOUCH_PHASE_NONE,
+	TOUCH_PHASE_BEGAN,
+	TOUCH_PHASE_MOVED,
+	TOUCH_PHASE_STATIONARY,
+	TOUCH_PHASE_ENDED
+} TouchPhase;
+
+// Touches as of the last processed frame, one slot per finger. Fields are
+// parallel arrays so gesture code scanning every touch reads one line each.
+// A slot keeps its id and position for the frame in which it ended.
+typedef struct TouchTable
+{
+	uint32 ids[LAL_MAX_TOUCHES];
+	sshort16 x[LAL_MAX_TOUCHES];
+	sshort16 y[LAL_MAX_TOUCHES];
+	uchar8 phases[LAL_MAX_TOUCHES];
+
+	// Bit per slot, this frame and the one before
+	uint32 down;
+	uint32 previous_down;
+} TouchTable;
+
+// XInput 2 device ids are below this, the device table is indexed by them
+#define LAL_MAX_INPUT_DEVICES 256
+
+#define LAL_INPUT_DEVICE_NAME_SIZE 64
+
+typedef enum InputDeviceType
+{
+	INPUT_DEVICE_KEYBOARD,
+	INPUT_DEVICE_POINTER
+} InputDeviceType;
+
+// State of one physical keyboard or pointer, see INPUT_FEATURE_PER_DEVICE.
+// Allocated when the device appears and freed when it goes away.
+typedef struct DeviceInput
+{
+	uint32 id;
+	uint32 type;
+
+	// Master device it is attached to, 0 while floating. The keyboard and
+	// pointer of one seat share a master pair.
+	uint32 master;
+
+	// One bit per Keys value, and per Buttons value, as of the last frame
+	ullong64 keys[4];
+	ullong64 previous_keys[4];
+	uint32 buttons;
+	uint32 previous_buttons;
+
+	sshort16 mouse_x;
+	sshort16 mouse_y;
+
+	char name[LAL_INPUT_DEVICE_NAME_SIZE];
+} DeviceInput;
+
+// Input state as of one processed frame, see input_read_snapshot
+typedef struct InputSnapshot
+{
+	// One bit per Keys value
+	ullong64 keys[4];
+	ullong64 previous_keys[4];
+
+	sshort16 mouse_x;
+	sshort16 mouse_y;
+
+	// Incremented by every input_publish
+	uint32 frame;
+} InputSnapshot;
+
 void input_initialize();
+void input_shutdown();
 
 b8 is_key_down(Keys key);
 b8 was_key_down(Keys key);
@@ -407,10 +482,53 @@ b8 was_key_down(Keys key);
 b8 is_key_up(Keys key);
 b8 was_key_up(Keys key);
 
+// Auto-repeats received since the key went down
+ushort16 get_key_repeat_count(Keys key);
+
 void input_process_key(Keys key, b8 pressed);
+void input_process_mouse_move(sshort16 x, sshort16 y);
+
+// phase is TOUCH_PHASE_BEGAN, MOVED or ENDED. Applied to the table at the
+// next input_publish, a touch that begins and ends in one batch is still
+// reported down for a frame.
+void input_process_touch(uint32 id, TouchPhase phase, sshort16 x, sshort16 y);
+
+const TouchTable *get_touch_table();
+
+// Per-device state, kept next to the global state that all devices feed.
+// Adding a known id updates it in place.
+void input_add_device(uint32 id, InputDeviceType type, uint32 master, const char *name);
+void input_remove_device(uint32 id);
+void input_process_device_key(uint32 id, Keys key, b8 pressed);
+void input_process_device_button(uint32 id, Buttons button, b8 pressed);
+void input_process_device_motion(uint32 id, sshort16 x, sshort16 y);
+
+// NULL for unknown devices, a table lookup
+const DeviceInput *get_device_input(uint32 id);
+
+// Copies up to capacity ids of known devices, returns how many there are
+uint32 get_input_devices(uint32 *ids, uint32 capacity);
+
+b8 is_device_key_down(uint32 id, Keys key);
+b8 was_device_key_down(uint32 id, Keys key);
+b8 is_device_button_down(uint32 id, Buttons button);
+b8 was_device_button_down(uint32 id, Buttons button);
+b8 is_touch_down(uint32 slot);
+b8 was_touch_down(uint32 slot);
 
 void input_update();
 
+// Publishes the current state as a new snapshot. Called by the platform
+// after each processed batch, from the event thread only.
+void input_publish();
+
+// Copies the latest published snapshot. Lock-free and safe from any thread,
+// the copy is never torn by a concurrent publish.
+void input_read_snapshot(InputSnapshot *snapshot);
+
+b8 snapshot_is_key_down(const InputSnapshot *snapshot, Keys key);
+b8 snapshot_was_key_down(const InputSnapshot *snapshot, Keys key);
+
 #endif // LPLATFORM_LINUX
 
 #endif // LAL_INPUT_H
@@ -0,0 +1,64 @@
+#ifndef LAL_LOG_H
+#define LAL_LOG_H
+
+#include "lal_defines.h"
+
+typedef enum LalLogLevel
+{
+	LAL_LOG_ERROR = 1,
+	LAL_LOG_WARN,
+	LAL_LOG_INFO,
+	LAL_LOG_DEBUG
+} LalLogLevel;
+
+// Messages above this level are compiled out, set by the LAL_LOG_LEVEL
+// CMake option. 0 strips everything, 1 error, 2 warn, 3 info, 4 debug.
+#ifndef LAL_LOG_COMPILE_LEVEL
+#define LAL_LOG_COMPILE_LEVEL 3
+#endif
+
+// Called on the writer thread for every message, without trailing newline
+typedef void (*LalLogSink)(void *user_data, LalLogLevel level, const char *message);
+
+// Formats the message into a lock-free ring and returns. A background
+// thread, started on the first message, writes it to stderr or the sink.
+// Messages are dropped, and counted, while the ring is full.
+void lal_log(LalLogLevel level, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+// Messages above level are discarded before formatting, default LAL_LOG_INFO
+void lal_log_set_level(LalLogLevel level);
+
+// NULL restores the stderr writer. Must be called before the first message.
+void lal_log_set_sink(LalLogSink sink, void *user_data);
+
+// Blocks until every message logged so far has been written
+void lal_log_flush();
+
+// Flushes and stops the writer thread, also runs at exit
+void lal_log_shutdown();
+
+#if LAL_LOG_COMPILE_LEVEL >= 1
+#define LAL_ERROR(...) lal_log(LAL_LOG_ERROR, __VA_ARGS__)
+#else
+#define LAL_ERROR(...) ((void)0)
+#endif
+
+#if LAL_LOG_COMPILE_LEVEL >= 2
+#define LAL_WARN(...) lal_log(LAL_LOG_WARN, __VA_ARGS__)
+#else
+#define LAL_WARN(...) ((void)0)
+#endif
+
+#if LAL_LOG_COMPILE_LEVEL >= 3
+#define LAL_INFO(...) lal_log(LAL_LOG_INFO, __VA_ARGS__)
+#else
+#define LAL_INFO(...) ((void)0)
+#endif
+
+#if LAL_LOG_COMPILE_LEVEL >= 4
+#define LAL_DEBUG(...) lal_log(LAL_LOG_DEBUG, __VA_ARGS__)
+#else
+#define LAL_DEBUG(...) ((void)0)
+#endif
+
+#endif // LAL_LOG_H
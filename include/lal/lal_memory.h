@@ -0,0 +1,79 @@
+#ifndef LAL_MEMORY_H
+#define LAL_MEMORY_H
+
+#include "lal_defines.h"
+
+#include <stddef.h>
+
+// Callback set used for every allocation LAL makes.
+// deallocate receives the size given to allocate.
+typedef struct LalAllocator
+{
+	void *(*allocate)(void *user_data, size_t size);
+	void (*deallocate)(void *user_data, void *ptr, size_t size);
+	void *user_data;
+} LalAllocator;
+
+typedef struct LalMemoryStats
+{
+	size_t live_bytes;
+	size_t peak_bytes;
+	ullong64 allocation_count;
+	ullong64 live_allocations;
+} LalMemoryStats;
+
+// Per-caller state of lal_memory_check_frame, start it zeroed
+typedef struct LalFrameCheck
+{
+	uint32 frames;
+	ullong64 allocation_count;
+} LalFrameCheck;
+
+// Linear arena over a caller owned block, individual frees are no-ops.
+// Installed as the allocator, its blocks count as live until
+// lal_arena_reset, lal_free does not lower the stats.
+typedef struct LalArena
+{
+	uchar8 *memory;
+	size_t capacity;
+	size_t offset;
+} LalArena;
+
+// Fixed-size block pool over a caller owned, 16 byte aligned block.
+// block_size is rounded up to a multiple of 16, size the block for
+// block_count of the rounded blocks.
+typedef struct LalPool
+{
+	uchar8 *memory;
+	size_t block_size;
+	size_t block_count;
+	size_t used_blocks;
+	void *free_list;
+} LalPool;
+
+// Installs the allocator, NULL restores the default malloc/free one.
+// Must be called before any window is created.
+void lal_memory_initialize(const LalAllocator *allocator);
+
+void *lal_allocate(size_t size);
+void lal_free(void *ptr, size_t size);
+
+LalMemoryStats lal_memory_stats();
+
+// Debug helper, call once per frame. After warmup_frames calls it asserts
+// that nothing was allocated through LAL since the previous call. Heap
+// allocations of other libraries are not seen: libxcb mallocs each event
+// it returns and cannot be handed storage.
+void lal_memory_check_frame(LalFrameCheck *check, uint32 warmup_frames);
+
+void lal_arena_create(LalArena *arena, void *memory, size_t capacity);
+void *lal_arena_allocate(LalArena *arena, size_t size);
+void lal_arena_reset(LalArena *arena);
+LalAllocator lal_arena_allocator(LalArena *arena);
+
+b8 lal_pool_create(LalPool *pool, void *memory, size_t block_size, size_t block_count);
+void *lal_pool_allocate(LalPool *pool);
+void lal_pool_free(LalPool *pool, void *ptr);
+LalAllocator lal_pool_allocator(LalPool *pool);
+
+#endif // LAL_MEMORY_H
@@ -0,0 +1,61 @@
+#ifndef LAL_MONITOR_H
+#define LAL_MONITOR_H
+
+#include "lal_defines.h"
+#include "lal/lal_window.h"
+
+#if LPLATFORM_LINUX
+
+#define LAL_MAX_MONITORS 16
+#define LAL_MONITOR_NAME_SIZE 32
+
+typedef struct LalMonitor
+{
+	char name[LAL_MONITOR_NAME_SIZE];
+
+	// Root window coordinates in pixels
+	sint32 x;
+	sint32 y;
+	uint32 width;
+	uint32 height;
+
+	// Physical size, 0 when the output does not report one
+	uint32 width_mm;
+	uint32 height_mm;
+
+	// Of the mode driving the first output, 0 when unknown
+	f32 refresh_hz;
+
+	// Physical DPI from the sizes above, 0 when unknown
+	f32 dpi_x;
+	f32 dpi_y;
+
+	b8 primary;
+} LalMonitor;
+
+typedef struct LalMonitorTable
+{
+	LalMonitor monitors[LAL_MAX_MONITORS];
+	uint32 count;
+
+	// Xft.dpi from the resource database, 96 when it is not set
+	f32 xft_dpi;
+
+	// Bumped on every refresh
+	uint32 generation;
+} LalMonitorTable;
+
+// Monitors as RandR reported them. Queried when the window is created and
+// refreshed once per batch of RandR notifications, when the poll produces
+// LAL_EVENT_MONITORS_CHANGED or on the first read after them, whichever
+// comes first. Other reads never talk to the server.
+// Without RandR 1.5 the screen is reported as a single monitor.
+const LalMonitorTable *lal_get_monitors(PlatformHandler *platform_handler);
+
+// Index in the table of the monitor under the window center, -1 if none.
+// Follows the window position from ConfigureNotify, no request either.
+sint32 lal_get_window_monitor(PlatformHandler *platform_handler);
+
+#endif // LPLATFORM_LINUX
+
+#endif // LAL_MONITOR_H
@@ -0,0 +1,40 @@
+#ifndef LAL_RAW_KEYBOARD_H
+#define LAL_RAW_KEYBOARD_H
+
+#include "lal_defines.h"
+#include "lal/lal_window.h"
+
+#if LPLATFORM_LINUX
+
+#define LAL_MAX_RAW_KEYBOARDS 8
+
+typedef enum LalRawKeyboardFlags
+{
+	// Takes the devices with EVIOCGRAB, X and the console stop seeing them
+	LAL_RAW_KEYBOARD_GRAB = 1 << 0,
+
+	// Delivers keys without window focus, for kiosks without a window manager
+	LAL_RAW_KEYBOARD_IGNORE_FOCUS = 1 << 1
+} LalRawKeyboardFlags;
+
+// Opt-in keyboard path for kiosks and dedicated displays. Reads every keyboard
+// in /dev/input through evdev and maps the scancodes straight into Keys,
+// skipping the X server and XKB. Needs read access to the event nodes.
+//
+// While active, X key events of the window are dropped and the evdev keys
+// are delivered by lal_poll_events and lal_window_process_events instead.
+// Presses only apply while the window has focus, keys held when focus is
+// lost are released.
+b8 lal_raw_keyboard_initialize(PlatformHandler *platform_handler, uint32 flags);
+void lal_raw_keyboard_shutdown();
+
+// Opens one device, returns its keyboard index or -1. Like lal_gamepad_open,
+// paths that are not evdev devices are read as recorded input_event streams.
+sint32 lal_raw_keyboard_open(const char *path);
+
+// Number of keyboards open
+uint32 lal_raw_keyboard_count();
+
+#endif // LPLATFORM_LINUX
+
+#endif // LAL_RAW_KEYBOARD_H
@@ -0,0 +1,94 @@
+#ifndef LAL_RECORDER_H
+#define LAL_RECORDER_H
+
+#include "lal_defines.h"
+#include "lal/lal_capture.h"
+
+#if LPLATFORM_LINUX
+
+typedef enum LalRecordFormat
+{
+	// LalRecordFileHeader, then slots of LalRecordSlotHeader and BGRA pixels
+	LAL_RECORD_RAW,
+
+	// YUV4MPEG2 stream in C444, one FRAME per slot. Each FRAME line carries
+	// Xidx=<capture index> and Xpts=<timestamp ns>. Once the ring wraps the
+	// frames are out of order, sort them by Xpts.
+	LAL_RECORD_Y4M
+} LalRecordFormat;
+
+typedef enum LalRecordDropPolicy
+{
+	// New frames are dropped while every slot still waits for its flush
+	LAL_RECORD_DROP_NEWEST,
+
+	// The oldest unflushed slot is reused, the file keeps the latest frames.
+	// A frame whose slot is being flushed at that moment is dropped.
+	LAL_RECORD_DROP_OLDEST
+} LalRecordDropPolicy;
+
+typedef struct LalRecorderConfig
+{
+	const char *path;
+	LalRecordFormat format;
+	LalRecordDropPolicy drop_policy;
+
+	// Frames of another size are dropped
+	uint32 width;
+	uint32 height;
+
+	// Frames the ring file holds, at least 2
+	uint32 slot_count;
+
+	// Only written to the Y4M header
+	uint32 fps;
+} LalRecorderConfig;
+
+#define LAL_RECORD_MAGIC "LALREC1"
+#define LAL_RECORD_VERSION 1
+
+typedef struct LalRecordFileHeader
+{
+	char magic[8];
+	uint32 version;
+	uint32 width;
+	uint32 height;
+	uint32 stride;
+	uint32 slot_count;
+	uint32 reserved;
+	ullong64 slot_size;
+	ullong64 data_offset;
+} LalRecordFileHeader;
+
+// Pixels follow the header at the next page boundary, top row first
+typedef struct LalRecordSlotHeader
+{
+	// 1 for the first frame recorded, 0 while the slot is being written
+	ullong64 sequence;
+	ullong64 index;
+	ullong64 timestamp_ns;
+} LalRecordSlotHeader;
+
+// Creates and preallocates the ring file, maps it and starts the writer
+// thread. Fails when the file system cannot reserve the whole file. Frames are copied into the mapping on the capture thread and a
+// background thread flushes them with msync, so recording never waits on
+// the disk. Only one recorder runs at a time.
+b8 lal_recorder_start(const LalRecorderConfig *config);
+
+// Flushes everything recorded, stops the writer and closes the file. Waits
+// for lal_recorder_write calls in progress on other threads.
+void lal_recorder_stop();
+
+// Copies a frame into the next slot, FAILED if it was dropped
+b8 lal_recorder_write(const LalCaptureFrame *frame);
+
+// LalCaptureCallback that records every frame, user_data is unused
+void lal_recorder_capture_callback(void *user_data, const LalCaptureFrame *frame);
+
+// Frames recorded and frames dropped since lal_recorder_start
+ullong64 lal_recorder_frames();
+ullong64 lal_recorder_dropped();
+
+#endif // LPLATFORM_LINUX
+
+#endif // LAL_RECORDER_H
@@ -0,0 +1,43 @@
+#ifndef LAL_TIMER_H
+#define LAL_TIMER_H
+
+#include "lal_defines.h"
+
+#if LPLATFORM_LINUX
+
+#define LAL_MAX_TIMERS 1024
+
+// 0 is never a valid timer
+typedef uint32 LalTimer;
+#define LAL_TIMER_INVALID 0
+
+// Runs on the thread polling events. May add and cancel timers, including
+// the one firing.
+typedef void (*LalTimerCallback)(void *user_data, LalTimer timer);
+
+// Timers live in a hierarchical wheel behind a single timerfd, armed for
+// the nearest deadline and registered as a wait source, so callbacks fire
+// from lal_poll_events next to the window events. Any number of pending
+// timers costs one wakeup at the earliest deadline.
+b8 lal_timer_initialize();
+void lal_timer_shutdown();
+
+// Fires after delay_ns, then every period_ns unless period_ns is 0.
+// Returns LAL_TIMER_INVALID when all LAL_MAX_TIMERS are in use.
+LalTimer lal_timer_add(ullong64 delay_ns, ullong64 period_ns, LalTimerCallback callback, void *user_data);
+
+// Stale or already cancelled timers are ignored
+void lal_timer_cancel(LalTimer timer);
+
+// Runs the callbacks that are due, for loops that do not use lal_poll_events
+void lal_timer_dispatch();
+
+// Timers pending or firing
+uint32 lal_timer_count();
+
+// The timerfd, -1 before lal_timer_initialize
+sint32 lal_timer_fd();
+
+#endif // LPLATFORM_LINUX
+
+#endif // LAL_TIMER_H
@@ -2,13 +2,179 @@
 #define LAL_WINDOW_H
 
 #include "lal_defines.h"
+#include "lal_error_list.h"
+#include "lal/lal_event.h"
+
+#include <stddef.h>
+
+// Window states an idle policy can be set for, most restrictive first
+typedef enum WindowActivity
+{
+	WINDOW_UNMAPPED,
+	WINDOW_OBSCURED,
+	WINDOW_UNFOCUSED,
+	WINDOW_ACTIVE,
+	WINDOW_ACTIVITY_COUNT
+} WindowActivity;
+
+typedef enum IdlePolicyMode
+{
+	// Return immediately when there are no events
+	IDLE_POLICY_POLL,
+
+	// Sleep until an event arrives
+	IDLE_POLICY_BLOCK,
+
+	// Run at most rate_hz times per second
+	IDLE_POLICY_CAP_RATE
+} IdlePolicyMode;
+
+typedef enum WindowBackend
+{
+	WINDOW_BACKEND_SIMPLE,
+	WINDOW_BACKEND_GL_XLIB,
+	WINDOW_BACKEND_XCB
+} WindowBackend;
+
+// Input the application consumes, only the matching X events are selected
+typedef enum InputFeatures
+{
+	INPUT_FEATURE_KEYBOARD = 1 << 0,
+	INPUT_FEATURE_MOUSE_BUTTONS = 1 << 1,
+	INPUT_FEATURE_MOUSE_MOTION = 1 << 2,
+	INPUT_FEATURE_POINTER_CROSSING = 1 << 3,
+
+	// Deliver auto-repeated presses as key events, e.g. for text fields.
+	// Otherwise repeats only bump the key repeat count.
+	INPUT_FEATURE_KEY_REPEAT = 1 << 4,
+
+	// XInput 2.2 touch events, the server then stops emulating the pointer
+	// for touches on this window
+	INPUT_FEATURE_TOUCH = 1 << 5,
+
+	// Keys, buttons and motion through XInput 2, tagged with the physical
+	// device and also kept per device, see get_device_input
+	INPUT_FEATURE_PER_DEVICE = 1 << 6,
+
+	INPUT_FEATURE_DEFAULT = INPUT_FEATURE_KEYBOARD | INPUT_FEATURE_MOUSE_BUTTONS
+} InputFeatures;
+
+typedef enum FullscreenMode
+{
+	FULLSCREEN_OFF,
+
+	// _NET_WM_STATE_FULLSCREEN through the window manager
+	FULLSCREEN_EWMH,
+
+	// Override-redirect window covering the monitor, the window manager
+	// is bypassed and the window takes the keyboard focus itself
+	FULLSCREEN_OVERRIDE
+} FullscreenMode;
+
+typedef struct IdlePolicy
+{
+	uint32 mode;
+	uint32 rate_hz;
+} IdlePolicy;
+
+// Called on the render thread once per frame, before the buffer swap
+typedef void (*RenderCallback)(void *user_data, uint32 width, uint32 height);
+
+// X protocol error, collected asynchronously by the error handlers
+typedef struct WindowXError
+{
+	// Sequence number of the failed request
+	ulong32 serial;
+	uint32 resource_id;
+	uchar8 error_code;
+	uchar8 request_code;
+	ushort16 minor_code;
+} WindowXError;
+
+typedef void (*WindowErrorCallback)(void *user_data, const WindowXError *error);
+
+typedef void (*WaitSourceCallback)(void *user_data);
+
+// One XFixes barrier per window edge
+#define LAL_POINTER_BARRIERS 4
 
 typedef struct PlatformHandler
 {
 	void* window;
 	b8 running;
+	uint32 backend;
+	uint32 input_features;
+
+	// Window state tracked from Map/Unmap, Visibility and Focus events
+	b8 mapped;
+	b8 obscured;
+	b8 focused;
+
+	// Set while lal_raw_keyboard reads the keys from evdev instead of X
+	b8 raw_keyboard;
+
+	// Pointer lock, see set_pointer_lock. The grab, barriers and hidden
+	// cursor are only held while the window has focus.
+	b8 pointer_locked;
+	b8 pointer_lock_active;
+	sint32 xi_opcode;
+	sint32 xi_minor;
+	ulong32 pointer_barriers[LAL_POINTER_BARRIERS];
+
+	// Fullscreen, see set_fullscreen. The windowed geometry is restored
+	// when leaving FULLSCREEN_OVERRIDE.
+	uint32 fullscreen_mode;
+	sint32 windowed_x;
+	sint32 windowed_y;
+	uint32 windowed_width;
+	uint32 windowed_height;
+
+	IdlePolicy idle_policies[WINDOW_ACTIVITY_COUNT];
+	ullong64 last_wake_ns;
+
+	// Client area size, kept current from ConfigureNotify
+	uint32 width;
+	uint32 height;
+
+	// Last server timestamp seen, for events that carry none
+	uint32 last_server_time;
+
+	// Set while a render thread owns the GL context
+	void *render_thread;
+
+	// Frame readback ring, see lal_capture.h. Only used on the GL thread.
+	void *capture;
+
+	// Selection ownership and transfers, see lal_clipboard.h
+	void *clipboard;
+
+	// Cached RandR monitors, see lal_monitor.h
+	void *monitors;
+
+	// X errors seen so far, and how many check_x_errors already reported
+	ullong64 x_error_count;
+	ullong64 x_error_checked;
+	WindowXError last_x_error;
+	WindowErrorCallback x_error_callback;
+	void *x_error_user_data;
 } PlatformHandler;
 
+// Values for LAL_WINDOW_BACKEND_PINNED, set by the LAL_WINDOW_BACKEND CMake option.
+// A pinned build only contains that backend and the lal_window_* calls below
+// inline straight into it. The runtime build dispatches through a table.
+#define LAL_BACKEND_RUNTIME 0
+#define LAL_BACKEND_SIMPLE 1
+#define LAL_BACKEND_GL_XLIB 2
+#define LAL_BACKEND_XCB 3
+
+#ifndef LAL_WINDOW_BACKEND_PINNED
+#define LAL_WINDOW_BACKEND_PINNED LAL_BACKEND_RUNTIME
+#endif
+
+#define LAL_HAS_BACKEND(backend) \
+	(LAL_WINDOW_BACKEND_PINNED == LAL_BACKEND_RUNTIME || LAL_WINDOW_BACKEND_PINNED == (backend))
+
+#if LAL_HAS_BACKEND(LAL_BACKEND_SIMPLE)
 b8 create_simple_window(
 	PlatformHandler *platform_handler,
 	uint32 x,
@@ -16,6 +182,13 @@ b8 create_simple_window(
 	uint32 width,
 	uint32 height);
 
+void run_simple_window(PlatformHandler *platform_handler);
+void shutdown_simple_window(PlatformHandler *platform_handler);
+void process_simple_window_events(PlatformHandler *platform_handler);
+uint32 poll_simple_window_events(PlatformHandler *platform_handler, LalEvent *events, uint32 capacity);
+#endif
+
+#if LAL_HAS_BACKEND(LAL_BACKEND_GL_XLIB)
 b8 create_gl_xlib_window(
 	PlatformHandler *platform_handler,
 	const char* window_title,
@@ -24,6 +197,13 @@ b8 create_gl_xlib_window(
 	uint32 width,
 	uint32 height);
 
+void run_gl_xlib_window(PlatformHandler *platform_handler);
+void shutdown_gl_xlib_window(PlatformHandler *platform_handler);
+void process_gl_xlib_events(PlatformHandler *platform_handler);
+uint32 poll_gl_xlib_events(PlatformHandler *platform_handler, LalEvent *events, uint32 capacity);
+#endif
+
+#if LAL_HAS_BACKEND(LAL_BACKEND_XCB)
 b8 create_xcb_window(
 	PlatformHandler *platform_handler,
 	const char* window_title,
@@ -32,17 +212,160 @@ b8 create_xcb_window(
 	uint32 width,
 	uint32 height);
 
-void run_gl_xlib_window(PlatformHandler *platform_handler);
 void run_xcb_window(PlatformHandler *platform_handler);
-
-void shutdown_simple_window(PlatformHandler *platform_handler);
-void shutdown_gl_xlib_window(PlatformHandler *platform_handler);
 void shutdown_xcb_window(PlatformHandler *platform_handler);
-
-void process_simple_window_events(PlatformHandler *platform_handler);
-void process_gl_xlib_events(PlatformHandler *platform_handler);
 void process_xcb_events(PlatformHandler *platform_handler);
 
+// Drains pending XCB events into a caller owned array without allocating,
+// returns how many were written. Input state is updated as well.
+uint32 poll_xcb_events(PlatformHandler *platform_handler, LalEvent *events, uint32 capacity);
+#endif
+
+// Backend independent window API
+
+#if LAL_WINDOW_BACKEND_PINNED == LAL_BACKEND_RUNTIME
+
+typedef struct WindowBackendVTable
+{
+	b8 (*create)(PlatformHandler *platform_handler, const char *window_title,
+		uint32 x, uint32 y, uint32 width, uint32 height);
+	void (*run)(PlatformHandler *platform_handler);
+	void (*shutdown)(PlatformHandler *platform_handler);
+	void (*process_events)(PlatformHandler *platform_handler);
+	uint32 (*poll_events)(PlatformHandler *platform_handler, LalEvent *events, uint32 capacity);
+} WindowBackendVTable;
+
+// Indexed by WindowBackend
+extern const WindowBackendVTable window_backends[];
+
+#define LAL_WINDOW_CALL(platform_handler, function) window_backends[(platform_handler)->backend].function
+
+static inline b8 lal_window_create(PlatformHandler *platform_handler, WindowBackend backend,
+	const char *window_title, uint32 x, uint32 y, uint32 width, uint32 height)
+{
+	if(backend > WINDOW_BACKEND_XCB)
+		return WINDOW_ERROR;
+
+	return window_backends[backend].create(platform_handler, window_title, x, y, width, height);
+}
+
+#else
+
+#if LAL_WINDOW_BACKEND_PINNED == LAL_BACKEND_SIMPLE
+#define LAL_PINNED_BACKEND WINDOW_BACKEND_SIMPLE
+#define LAL_PINNED_CREATE(platform_handler, window_title, x, y, width, height) \
+	((void)(window_title), create_simple_window(platform_handler, x, y, width, height))
+#define LAL_PINNED_run run_simple_window
+#define LAL_PINNED_shutdown shutdown_simple_window
+#define LAL_PINNED_process_events process_simple_window_events
+#define LAL_PINNED_poll_events poll_simple_window_events
+#elif LAL_WINDOW_BACKEND_PINNED == LAL_BACKEND_GL_XLIB
+#define LAL_PINNED_BACKEND WINDOW_BACKEND_GL_XLIB
+#define LAL_PINNED_CREATE create_gl_xlib_window
+#define LAL_PINNED_run run_gl_xlib_window
+#define LAL_PINNED_shutdown shutdown_gl_xlib_window
+#define LAL_PINNED_process_events process_gl_xlib_events
+#define LAL_PINNED_poll_events poll_gl_xlib_events
+#elif LAL_WINDOW_BACKEND_PINNED == LAL_BACKEND_XCB
+#define LAL_PINNED_BACKEND WINDOW_BACKEND_XCB
+#define LAL_PINNED_CREATE create_xcb_window
+#define LAL_PINNED_run run_xcb_window
+#define LAL_PINNED_shutdown shutdown_xcb_window
+#define LAL_PINNED_process_events process_xcb_events
+#define LAL_PINNED_poll_events poll_xcb_events
+#else
+#error "ERROR: Unknown LAL_WINDOW_BACKEND_PINNED value."
+#endif
+
+#define LAL_WINDOW_CALL(platform_handler, function) LAL_PINNED_##function
+
+// backend must be the pinned one, anything else fails
+static inline b8 lal_window_create(PlatformHandler *platform_handler, WindowBackend backend,
+	const char *window_title, uint32 x, uint32 y, uint32 width, uint32 height)
+{
+	if(backend != LAL_PINNED_BACKEND)
+		return WINDOW_ERROR;
+
+	return LAL_PINNED_CREATE(platform_handler, window_title, x, y, width, height);
+}
+
+#endif // LAL_WINDOW_BACKEND_PINNED
+
+static inline void lal_window_run(PlatformHandler *platform_handler)
+{
+	LAL_WINDOW_CALL(platform_handler, run)(platform_handler);
+}
+
+static inline void lal_window_shutdown(PlatformHandler *platform_handler)
+{
+	LAL_WINDOW_CALL(platform_handler, shutdown)(platform_handler);
+}
+
+// Processes pending events, blocking in XNextEvent on the Xlib backends
+static inline void lal_window_process_events(PlatformHandler *platform_handler)
+{
+	LAL_WINDOW_CALL(platform_handler, process_events)(platform_handler);
+}
+
+// Drains pending events of any backend into out, in arrival order, and
+// returns how many were written. Never blocks unless the idle policy says so.
+// Events that don't fit stay queued for the next call.
+static inline size_t lal_poll_events(PlatformHandler *platform_handler, LalEvent *out, size_t cap)
+{
+	uint32 capacity = cap > 0xFFFFFFFFu ? 0xFFFFFFFFu : (uint32)cap;
+	return LAL_WINDOW_CALL(platform_handler, poll_events)(platform_handler, out, capacity);
+}
+
+// Makes Xlib safe to share between the event and render threads.
+// Must be called before any window is created.
+b8 initialize_window_threads();
+
+// Moves the GL context of a gl_xlib or xcb window to a new render thread
+// that calls render and swaps every frame. Events keep being processed on
+// the calling thread, which must not issue GL calls until the thread stops.
+b8 start_render_thread(PlatformHandler *platform_handler, RenderCallback render, void *user_data);
+
+// Joins the render thread and makes the context current on the caller again
+void stop_render_thread(PlatformHandler *platform_handler);
+
+// Reselects the window event mask for the given InputFeatures.
+// Windows start with INPUT_FEATURE_DEFAULT, pointer motion is opt-in.
+void set_input_features(PlatformHandler *platform_handler, uint32 features);
+uint32 get_input_features(PlatformHandler *platform_handler);
+
+// Policy applied by process_xcb_events/poll_xcb_events while the window is in
+// the given state. Unmapped and obscured windows block by default.
+void set_idle_policy(PlatformHandler *platform_handler, WindowActivity activity, IdlePolicyMode mode, uint32 rate_hz);
+WindowActivity get_window_activity(PlatformHandler *platform_handler);
+
+// Extra descriptors watched next to the X connection by lal_poll_events and
+// the XCB backend, e.g. the gamepad epoll fd. dispatch runs on the polling
+// thread whenever fd is readable. Call from the thread that polls events.
+b8 add_wait_source(sint32 fd, WaitSourceCallback dispatch, void *user_data);
+void remove_wait_source(sint32 fd);
+
+// X errors are logged and counted instead of aborting the process. callback
+// runs inside Xlib or the event poll and must not issue X requests.
+void set_x_error_callback(PlatformHandler *platform_handler, WindowErrorCallback callback, void *user_data);
+ullong64 get_x_error_count(PlatformHandler *platform_handler);
+
+// Opt-in checkpoint, costs one round-trip. Returns WINDOW_ERROR if any X
+// error arrived since the previous checkpoint.
+b8 check_x_errors(PlatformHandler *platform_handler);
+
+// Mouse look without warping: grabs the pointer, confines it to the window
+// with XFixes barriers, hides the cursor and delivers LAL_EVENT_RELATIVE_MOTION
+// from XInput 2 raw events. Suspended while the window is unfocused.
+// Returns FAILED when the server has no XInput 2.
+b8 set_pointer_lock(PlatformHandler *platform_handler, b8 locked);
+b8 is_pointer_locked(PlatformHandler *platform_handler);
+
+// Both fullscreen modes set _NET_WM_BYPASS_COMPOSITOR so compositors can
+// unredirect the window and flip it straight to scanout. monitor indexes
+// lal_get_monitors, -1 keeps the monitor the window is on.
+b8 set_fullscreen(PlatformHandler *platform_handler, FullscreenMode mode, sint32 monitor);
+FullscreenMode get_fullscreen(PlatformHandler *platform_handler);
+
 b8 is_platform_running(PlatformHandler *platform_handler);
 void set_platform_running(PlatformHandler *platform_handler, b8 value);
 
@@ -0,0 +1,220 @@
+#include "lal_defines.h"
+#include "lal_error_list.h"
+#include "lal/lal_capture.h"
+#include "lal/lal_gl.h"
+#include "lal/lal_memory.h"
+#include "lal/lal_log.h"
+
+#if LPLATFORM_LINUX
+
+#include <time.h>
+
+// Upper bound for the waits in lal_capture_stop
+#define CAPTURE_STOP_TIMEOUT_NS 1000000000ull
+
+typedef struct CaptureSlot
+{
+	GLuint buffer;
+	GLsync fence;
+	size_t capacity;
+	uint32 width;
+	uint32 height;
+	ullong64 index;
+	ullong64 timestamp_ns;
+} CaptureSlot;
+
+// Slots form a ring: head is the next one to read into, the in_flight
+// slots before it hold fenced readbacks, oldest first
+typedef struct Capture
+{
+	CaptureSlot slots[LAL_CAPTURE_MAX_DEPTH];
+	uint32 depth;
+	uint32 head;
+	uint32 in_flight;
+	ullong64 frame_index;
+	ullong64 dropped;
+	LalCaptureCallback callback;
+	void *user_data;
+} Capture;
+
+static ullong64 capture_time_ns()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ullong64)ts.tv_sec * 1000000000ull + (ullong64)ts.tv_nsec;
+}
+
+// Maps the oldest slot and hands it to the callback
+static void deliver_slot(Capture *capture, CaptureSlot *slot)
+{
+	LalCaptureFrame frame;
+	uint32 stride = slot->width * 4;
+	size_t size = (size_t)stride * slot->height;
+
+	lal_gl.glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->buffer);
+
+	frame.pixels = lal_gl.glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)size, GL_MAP_READ_BIT);
+	if(frame.pixels != NULL)
+	{
+		frame.width = slot->width;
+		frame.height = slot->height;
+		frame.stride = stride;
+		frame.index = slot->index;
+		frame.timestamp_ns = slot->timestamp_ns;
+		capture->callback(capture->user_data, &frame);
+		lal_gl.glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	else
+	{
+		LAL_WARN("Failed to map capture buffer, frame dropped.");
+		capture->dropped++;
+	}
+
+	lal_gl.glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+// Delivers in order every frame old enough whose fence has signalled.
+// With drain set, waits for all of them instead.
+static void deliver_ready_frames(Capture *capture, b8 drain)
+{
+	while(capture->in_flight > 0)
+	{
+		uint32 oldest = (capture->head + capture->depth - capture->in_flight) % capture->depth;
+		CaptureSlot *slot = &capture->slots[oldest];
+
+		if(!drain && capture->frame_index - slot->index < capture->depth - 1)
+			return;
+
+		GLenum status = lal_gl.glClientWaitSync(slot->fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+			drain ? CAPTURE_STOP_TIMEOUT_NS : 0);
+		if(status == GL_TIMEOUT_EXPIRED && !drain)
+			return;
+
+		if(status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED)
+			deliver_slot(capture, slot);
+		else
+			capture->dropped++;
+
+		lal_gl.glDeleteSync(slot->fence);
+		slot->fence = NULL;
+		capture->in_flight--;
+	}
+}
+
+b8 lal_capture_start(PlatformHandler *platform_handler, uint32 depth, LalCaptureCallback callback, void *user_data)
+{
+	Capture *capture;
+	GLuint buffers[LAL_CAPTURE_MAX_DEPTH];
+
+	if(platform_handler->capture != NULL || callback == NULL)
+		return FAILED;
+
+	if(platform_handler->backend != WINDOW_BACKEND_GL_XLIB && platform_handler->backend != WINDOW_BACKEND_XCB)
+	{
+		LAL_ERROR("Capture needs a window with a GL context.");
+		return CONTEXT_ERROR;
+	}
+
+	if(depth == 0)
+		depth = 1;
+	if(depth > LAL_CAPTURE_MAX_DEPTH)
+		depth = LAL_CAPTURE_MAX_DEPTH;
+
+	capture = lal_allocate(sizeof(Capture));
+	if(capture == NULL)
+		return FAILED;
+
+	// Storage is allocated on the first readback, once the size is known
+	lal_gl.glGenBuffers((GLsizei)depth, buffers);
+	for(uint32 i = 0; i < depth; i++)
+	{
+		capture->slots[i].buffer = buffers[i];
+		capture->slots[i].fence = NULL;
+		capture->slots[i].capacity = 0;
+	}
+
+	capture->depth = depth;
+	capture->head = 0;
+	capture->in_flight = 0;
+	capture->frame_index = 0;
+	capture->dropped = 0;
+	capture->callback = callback;
+	capture->user_data = user_data;
+
+	platform_handler->capture = capture;
+
+	return OK;
+}
+
+void lal_capture_stop(PlatformHandler *platform_handler)
+{
+	Capture *capture = (Capture *)platform_handler->capture;
+	GLuint buffers[LAL_CAPTURE_MAX_DEPTH];
+
+	if(capture == NULL)
+		return;
+
+	deliver_ready_frames(capture, TRUE);
+
+	for(uint32 i = 0; i < capture->depth; i++)
+		buffers[i] = capture->slots[i].buffer;
+	lal_gl.glDeleteBuffers((GLsizei)capture->depth, buffers);
+
+	lal_free(capture, sizeof(Capture));
+	platform_handler->capture = NULL;
+}
+
+void lal_capture_frame(PlatformHandler *platform_handler, uint32 width, uint32 height)
+{
+	Capture *capture = (Capture *)platform_handler->capture;
+	CaptureSlot *slot;
+	size_t size;
+
+	if(capture == NULL || width == 0 || height == 0)
+		return;
+
+	deliver_ready_frames(capture, FALSE);
+
+	// The GPU is more than depth frames behind, skip rather than wait
+	if(capture->in_flight == capture->depth)
+	{
+		capture->frame_index++;
+		capture->dropped++;
+		return;
+	}
+
+	slot = &capture->slots[capture->head];
+	size = (size_t)width * 4 * height;
+
+	lal_gl.glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->buffer);
+
+	if(size > slot->capacity)
+	{
+		lal_gl.glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)size, NULL, GL_STREAM_READ);
+		slot->capacity = size;
+	}
+
+	// With a pack buffer bound the pointer is an offset, the copy is queued
+	// and glReadPixels returns without waiting for the frame
+	lal_gl.glReadBuffer(GL_BACK);
+	lal_gl.glReadPixels(0, 0, (GLsizei)width, (GLsizei)height, GL_BGRA, GL_UNSIGNED_BYTE, NULL);
+	slot->fence = lal_gl.glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	lal_gl.glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	slot->width = width;
+	slot->height = height;
+	slot->index = capture->frame_index++;
+	slot->timestamp_ns = capture_time_ns();
+
+	capture->head = (capture->head + 1) % capture->depth;
+	capture->in_flight++;
+}
+
+ullong64 lal_capture_dropped(PlatformHandler *platform_handler)
+{
+	Capture *capture = (Capture *)platform_handler->capture;
+	return capture != NULL ? capture->dropped : 0;
+}
+
+#endif // LPLATFORM_LINUX
@@ -0,0 +1,599 @@
+// ICCCM selections for the window backends: CLIPBOARD and PRIMARY text,
+// large transfers in both directions through the INCR protocol
+
+#include "lal_defines.h"
+#include "lal_error_list.h"
+#include "lal/lal_clipboard.h"
+#include "lal/lal_memory.h"
+#include "lal/lal_log.h"
+#include "lal_window_internal.h"
+
+#if LPLATFORM_LINUX
+
+#include <X11/Xatom.h>
+#include <string.h>
+#include <time.h>
+
+// Outgoing selections larger than this go through INCR, in pieces this size
+#define CLIPBOARD_CHUNK_SIZE (256 * 1024)
+
+// Requestors served through INCR at the same time
+#define CLIPBOARD_TRANSFERS 8
+
+// INCR transfers whose requestor stopped deleting the property for this
+// long are dropped, ICCCM leaves the timeout to the owner
+#define CLIPBOARD_TRANSFER_TIMEOUT_NS (10ULL * 1000000000ULL)
+
+// Data handed to lal_clipboard_set, the current one per selection plus any
+// replaced ones that are still being transferred
+#define CLIPBOARD_SOURCES 8
+
+enum
+{
+    ATOM_CLIPBOARD,
+    ATOM_PRIMARY,
+    ATOM_CLIPBOARD_PROPERTY,
+    ATOM_PRIMARY_PROPERTY,
+    ATOM_TARGETS,
+    ATOM_UTF8_STRING,
+    ATOM_TEXT,
+    ATOM_INCR,
+    ATOM_COUNT
+};
+
+static char *atom_names[ATOM_COUNT] = {
+    "CLIPBOARD",
+    "PRIMARY",
+    "LAL_CLIPBOARD",
+    "LAL_PRIMARY",
+    "TARGETS",
+    "UTF8_STRING",
+    "TEXT",
+    "INCR"
+};
+
+typedef enum ReceiveState
+{
+    RECEIVE_IDLE,
+    RECEIVE_WAITING,
+    RECEIVE_INCR
+} ReceiveState;
+
+typedef struct Receive
+{
+    ReceiveState state;
+    LalClipboardReceiver receiver;
+    void *user_data;
+} Receive;
+
+typedef struct Source
+{
+    const uchar8 *data;
+    size_t size;
+    LalClipboardRelease release;
+    void *user_data;
+    uint32 transfers;
+    b8 in_use;
+    b8 owned;
+} Source;
+
+typedef struct Transfer
+{
+    ulong32 requestor;
+    ulong32 property;
+    ulong32 type;
+    Source *source;
+    size_t offset;
+
+    // Monotonic time of the last piece sent
+    ullong64 active_ns;
+} Transfer;
+
+typedef struct Clipboard
+{
+    Atom atoms[ATOM_COUNT];
+    size_t chunk_size;
+    Receive receives[LAL_SELECTION_COUNT];
+    Source *owned[LAL_SELECTION_COUNT];
+    Source sources[CLIPBOARD_SOURCES];
+    Transfer transfers[CLIPBOARD_TRANSFERS];
+} Clipboard;
+
+static Clipboard *get_clipboard(PlatformHandler *platform_handler, Display *display)
+{
+    Clipboard *clipboard = (Clipboard *)platform_handler->clipboard;
+    if(clipboard != NULL || display == NULL)
+        return clipboard;
+
+    clipboard = lal_allocate(sizeof(Clipboard));
+    if(clipboard == NULL)
+        return NULL;
+
+    memset(clipboard, 0, sizeof(Clipboard));
+    XInternAtoms(display, atom_names, ATOM_COUNT, False, clipboard->atoms);
+
+    // A property has to fit in one request, leave room for its header
+    size_t max_request = XExtendedMaxRequestSize(display);
+    if(max_request == 0)
+        max_request = XMaxRequestSize(display);
+    clipboard->chunk_size = max_request * 4 - 64;
+    if(clipboard->chunk_size > CLIPBOARD_CHUNK_SIZE)
+        clipboard->chunk_size = CLIPBOARD_CHUNK_SIZE;
+
+    platform_handler->clipboard = clipboard;
+    return clipboard;
+}
+
+static ulong32 selection_atom(Clipboard *clipboard, LalSelection selection)
+{
+    return clipboard->atoms[selection == LAL_SELECTION_PRIMARY ? ATOM_PRIMARY : ATOM_CLIPBOARD];
+}
+
+static ulong32 property_atom(Clipboard *clipboard, LalSelection selection)
+{
+    return clipboard->atoms[selection == LAL_SELECTION_PRIMARY ? ATOM_PRIMARY_PROPERTY : ATOM_CLIPBOARD_PROPERTY];
+}
+
+static sint32 find_selection(Clipboard *clipboard, ulong32 atom)
+{
+    if(atom == clipboard->atoms[ATOM_CLIPBOARD])
+        return LAL_SELECTION_CLIPBOARD;
+    if(atom == clipboard->atoms[ATOM_PRIMARY])
+        return LAL_SELECTION_PRIMARY;
+    return -1;
+}
+
+static ullong64 monotonic_ns()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (ullong64)now.tv_sec * 1000000000ULL + (ullong64)now.tv_nsec;
+}
+
+static uint32 selection_time(PlatformHandler *platform_handler)
+{
+    return platform_handler->last_server_time != 0 ? platform_handler->last_server_time : CurrentTime;
+}
+
+static void finish_receive(Clipboard *clipboard, LalSelection selection, LalClipboardStatus status)
+{
+    Receive *receive = &clipboard->receives[selection];
+    receive->state = RECEIVE_IDLE;
+    receive->receiver(receive->user_data, selection, status, NULL, 0);
+}
+
+// Hands the property to the receiver straight from the reply and deletes
+// it, which asks an INCR owner for the next piece. Returns the type.
+static ulong32 read_property(Clipboard *clipboard, Display *display, ulong32 window, ulong32 property,
+        LalSelection selection, size_t *size)
+{
+    Atom type = None;
+    sint32 format = 0;
+    unsigned long count = 0;
+    unsigned long remaining = 0;
+    uchar8 *data = NULL;
+
+    *size = 0;
+    if(XGetWindowProperty(display, window, property, 0, 0x1FFFFFFF, True, AnyPropertyType,
+            &type, &format, &count, &remaining, &data) != Success)
+        return None;
+
+    // Xlib widens 32 bit items to longs
+    *size = count * (format == 32 ? sizeof(long) : (size_t)format / 8);
+
+    if(*size > 0 && data != NULL && type != clipboard->atoms[ATOM_INCR])
+    {
+        Receive *receive = &clipboard->receives[selection];
+        receive->receiver(receive->user_data, selection, LAL_CLIPBOARD_CHUNK, data, *size);
+    }
+
+    if(data != NULL)
+        XFree(data);
+
+    return type;
+}
+
+void handle_selection_notify(PlatformHandler *platform_handler, ulong32 selection_atom_id, ulong32 property)
+{
+    ulong32 window;
+    size_t size;
+    Display *display = get_x_window(platform_handler, &window);
+    Clipboard *clipboard = get_clipboard(platform_handler, NULL);
+    if(clipboard == NULL)
+        return;
+
+    sint32 selection = find_selection(clipboard, selection_atom_id);
+    if(selection < 0 || clipboard->receives[selection].state != RECEIVE_WAITING)
+        return;
+
+    if(property == None)
+    {
+        finish_receive(clipboard, (LalSelection)selection, LAL_CLIPBOARD_FAILED);
+        return;
+    }
+
+    ulong32 type = read_property(clipboard, display, window, property, (LalSelection)selection, &size);
+
+    // Deleting the INCR property was the go-ahead, pieces follow as PropertyNotify
+    if(type == clipboard->atoms[ATOM_INCR])
+    {
+        clipboard->receives[selection].state = RECEIVE_INCR;
+        XFlush(display);
+        return;
+    }
+
+    finish_receive(clipboard, (LalSelection)selection, type == None ? LAL_CLIPBOARD_FAILED : LAL_CLIPBOARD_DONE);
+}
+
+static Transfer *find_transfer(Clipboard *clipboard, ulong32 requestor, ulong32 property)
+{
+    for(uint32 i = 0; i < CLIPBOARD_TRANSFERS; i++)
+    {
+        Transfer *transfer = &clipboard->transfers[i];
+        if(transfer->source != NULL && transfer->requestor == requestor && transfer->property == property)
+            return transfer;
+    }
+    return NULL;
+}
+
+static void release_source(Source *source)
+{
+    if(source->owned || source->transfers > 0)
+        return;
+
+    if(source->release != NULL)
+        source->release(source->user_data, source->data, source->size);
+    source->in_use = FALSE;
+}
+
+// requestor_alive is FALSE once the requestor window is gone, nothing is
+// sent to it then
+static void end_transfer(Clipboard *clipboard, Display *display, ulong32 window, Transfer *transfer,
+        b8 requestor_alive)
+{
+    Source *source = transfer->source;
+    ulong32 requestor = transfer->requestor;
+
+    transfer->source = NULL;
+    source->transfers--;
+    release_source(source);
+
+    // Stop listening to the requestor once nothing is sent to it anymore
+    for(uint32 i = 0; i < CLIPBOARD_TRANSFERS; i++)
+    {
+        if(clipboard->transfers[i].source != NULL && clipboard->transfers[i].requestor == requestor)
+            return;
+    }
+    if(requestor != window && requestor_alive)
+        XSelectInput(display, requestor, NoEventMask);
+}
+
+// Drops the transfers whose requestor went quiet, so they do not pin
+// their source and take up a slot forever
+static void expire_transfers(Clipboard *clipboard, Display *display, ulong32 window)
+{
+    ullong64 now = monotonic_ns();
+    for(uint32 i = 0; i < CLIPBOARD_TRANSFERS; i++)
+    {
+        Transfer *transfer = &clipboard->transfers[i];
+        if(transfer->source == NULL || now - transfer->active_ns < CLIPBOARD_TRANSFER_TIMEOUT_NS)
+            continue;
+
+        LAL_WARN("Selection transfer timed out.");
+        end_transfer(clipboard, display, window, transfer, TRUE);
+    }
+}
+
+// The requestor deleted the last piece, send the next one straight from
+// the source. A zero length piece ends the transfer.
+static void send_next_chunk(Clipboard *clipboard, Display *display, ulong32 window, Transfer *transfer)
+{
+    Source *source = transfer->source;
+    size_t size = source->size - transfer->offset;
+    if(size > clipboard->chunk_size)
+        size = clipboard->chunk_size;
+
+    XChangeProperty(display, transfer->requestor, transfer->property, transfer->type, 8, PropModeReplace,
+        source->data + transfer->offset, (sint32)size);
+    transfer->offset += size;
+    transfer->active_ns = monotonic_ns();
+
+    if(size == 0)
+        end_transfer(clipboard, display, window, transfer, TRUE);
+
+    XFlush(display);
+}
+
+void handle_property_notify(PlatformHandler *platform_handler, ulong32 event_window, ulong32 atom, b8 deleted)
+{
+    ulong32 window;
+    size_t size;
+    Display *display = get_x_window(platform_handler, &window);
+    Clipboard *clipboard = get_clipboard(platform_handler, NULL);
+    if(clipboard == NULL)
+        return;
+
+    if(deleted)
+    {
+        Transfer *transfer = find_transfer(clipboard, event_window, atom);
+        if(transfer != NULL)
+            send_next_chunk(clipboard, display, window, transfer);
+        expire_transfers(clipboard, display, window);
+        return;
+    }
+
+    if(event_window != window)
+        return;
+
+    for(uint32 selection = 0; selection < LAL_SELECTION_COUNT; selection++)
+    {
+        if(clipboard->receives[selection].state != RECEIVE_INCR || atom != property_atom(clipboard, selection))
+            continue;
+
+        read_property(clipboard, display, window, atom, (LalSelection)selection, &size);
+        XFlush(display);
+
+        if(size == 0)
+            finish_receive(clipboard, (LalSelection)selection, LAL_CLIPBOARD_DONE);
+    }
+}
+
+static void send_selection_notify(Display *display, ulong32 requestor, ulong32 selection, ulong32 target,
+        ulong32 property, uint32 time)
+{
+    XEvent notify;
+    memset(&notify, 0, sizeof(notify));
+    notify.xselection.type = SelectionNotify;
+    notify.xselection.requestor = requestor;
+    notify.xselection.selection = selection;
+    notify.xselection.target = target;
+    notify.xselection.property = property;
+    notify.xselection.time = time;
+
+    XSendEvent(display, requestor, False, NoEventMask, &notify);
+    XFlush(display);
+}
+
+void handle_destroy_notify(PlatformHandler *platform_handler, ulong32 destroyed)
+{
+    ulong32 window;
+    Display *display = get_x_window(platform_handler, &window);
+    Clipboard *clipboard = get_clipboard(platform_handler, NULL);
+    if(clipboard == NULL)
+        return;
+
+    for(uint32 i = 0; i < CLIPBOARD_TRANSFERS; i++)
+    {
+        Transfer *transfer = &clipboard->transfers[i];
+        if(transfer->source != NULL && transfer->requestor == destroyed)
+            end_transfer(clipboard, display, window, transfer, FALSE);
+    }
+}
+
+// Answers with the data, or the INCR header and a transfer entry for
+// selections larger than a request. The text is UTF-8, also for TEXT.
+// Returns FALSE to refuse.
+static b8 serve_text(Clipboard *clipboard, Display *display, ulong32 window, Source *source,
+        ulong32 requestor, ulong32 property)
+{
+    ulong32 type = clipboard->atoms[ATOM_UTF8_STRING];
+
+    if(source->size <= clipboard->chunk_size)
+    {
+        XChangeProperty(display, requestor, property, type, 8, PropModeReplace,
+            source->data, (sint32)source->size);
+        return TRUE;
+    }
+
+    expire_transfers(clipboard, display, window);
+
+    Transfer *transfer = NULL;
+    for(uint32 i = 0; i < CLIPBOARD_TRANSFERS && transfer == NULL; i++)
+    {
+        if(clipboard->transfers[i].source == NULL)
+            transfer = &clipboard->transfers[i];
+    }
+    if(transfer == NULL)
+    {
+        LAL_WARN("Too many selection transfers, request refused.");
+        return FALSE;
+    }
+
+    // Our own window already listens to property changes. DestroyNotify
+    // ends the transfer when the requestor goes away mid-way.
+    if(requestor != window)
+        XSelectInput(display, requestor, PropertyChangeMask | StructureNotifyMask);
+
+    long total = (long)source->size;
+    XChangeProperty(display, requestor, property, clipboard->atoms[ATOM_INCR], 32, PropModeReplace,
+        (const uchar8 *)&total, 1);
+
+    transfer->requestor = requestor;
+    transfer->property = property;
+    transfer->type = type;
+    transfer->source = source;
+    transfer->offset = 0;
+    transfer->active_ns = monotonic_ns();
+    source->transfers++;
+
+    return TRUE;
+}
+
+void handle_selection_request(PlatformHandler *platform_handler, ulong32 requestor, ulong32 selection_atom_id,
+        ulong32 target, ulong32 property, uint32 time)
+{
+    ulong32 window;
+    Display *display = get_x_window(platform_handler, &window);
+    Clipboard *clipboard = get_clipboard(platform_handler, NULL);
+    b8 served = FALSE;
+
+    // Obsolete clients leave the property to the owner
+    if(property == None)
+        property = target;
+
+    sint32 selection = clipboard != NULL ? find_selection(clipboard, selection_atom_id) : -1;
+    Source *source = selection >= 0 ? clipboard->owned[selection] : NULL;
+
+    // STRING would need a Latin-1 copy of the data, UTF-8 is served as is
+    if(source != NULL && target == clipboard->atoms[ATOM_TARGETS])
+    {
+        Atom targets[] = {
+            clipboard->atoms[ATOM_TARGETS], clipboard->atoms[ATOM_UTF8_STRING], clipboard->atoms[ATOM_TEXT]
+        };
+        XChangeProperty(display, requestor, property, XA_ATOM, 32, PropModeReplace,
+            (const uchar8 *)targets, sizeof(targets) / sizeof(targets[0]));
+        served = TRUE;
+    }
+    else if(source != NULL && (target == clipboard->atoms[ATOM_UTF8_STRING]
+            || target == clipboard->atoms[ATOM_TEXT]))
+    {
+        served = serve_text(clipboard, display, window, source, requestor, property);
+    }
+
+    send_selection_notify(display, requestor, selection_atom_id, target, served ? property : None, time);
+}
+
+void handle_selection_clear(PlatformHandler *platform_handler, ulong32 selection_atom_id)
+{
+    Clipboard *clipboard = get_clipboard(platform_handler, NULL);
+    if(clipboard == NULL)
+        return;
+
+    sint32 selection = find_selection(clipboard, selection_atom_id);
+    if(selection < 0 || clipboard->owned[selection] == NULL)
+        return;
+
+    Source *source = clipboard->owned[selection];
+    clipboard->owned[selection] = NULL;
+    source->owned = FALSE;
+    release_source(source);
+}
+
+b8 lal_clipboard_request(PlatformHandler *platform_handler, LalSelection selection,
+        LalClipboardReceiver receiver, void *user_data)
+{
+    ulong32 window;
+    Display *display = get_x_window(platform_handler, &window);
+    Clipboard *clipboard = get_clipboard(platform_handler, display);
+
+    if(clipboard == NULL || receiver == NULL || (uint32)selection >= LAL_SELECTION_COUNT)
+        return FAILED;
+
+    Receive *receive = &clipboard->receives[selection];
+    if(receive->state != RECEIVE_IDLE)
+        return FAILED;
+
+    // Leftovers of a cancelled INCR transfer would read as the first piece
+    XDeleteProperty(display, window, property_atom(clipboard, selection));
+
+    receive->state = RECEIVE_WAITING;
+    receive->receiver = receiver;
+    receive->user_data = user_data;
+
+    XConvertSelection(display, selection_atom(clipboard, selection), clipboard->atoms[ATOM_UTF8_STRING],
+        property_atom(clipboard, selection), window, selection_time(platform_handler));
+    XFlush(display);
+
+    return OK;
+}
+
+void lal_clipboard_cancel(PlatformHandler *platform_handler, LalSelection selection)
+{
+    Clipboard *clipboard = get_clipboard(platform_handler, NULL);
+    if(clipboard == NULL || (uint32)selection >= LAL_SELECTION_COUNT)
+        return;
+
+    clipboard->receives[selection].state = RECEIVE_IDLE;
+}
+
+b8 lal_clipboard_set(PlatformHandler *platform_handler, LalSelection selection, const uchar8 *data, size_t size,
+        LalClipboardRelease release, void *user_data)
+{
+    ulong32 window;
+    Display *display = get_x_window(platform_handler, &window);
+    Clipboard *clipboard = get_clipboard(platform_handler, display);
+    Source *source = NULL;
+
+    if(clipboard == NULL || (uint32)selection >= LAL_SELECTION_COUNT || (data == NULL && size > 0))
+        return FAILED;
+
+    // A property length is a signed 32 bit count
+    if(size > 0x7FFFFFFF)
+        return FAILED;
+
+    for(uint32 i = 0; i < CLIPBOARD_SOURCES && source == NULL; i++)
+    {
+        if(!clipboard->sources[i].in_use)
+            source = &clipboard->sources[i];
+    }
+    if(source == NULL)
+    {
+        LAL_ERROR("Previous selections are still being transferred.");
+        return FAILED;
+    }
+
+    ulong32 atom = selection_atom(clipboard, selection);
+    XSetSelectionOwner(display, atom, window, selection_time(platform_handler));
+    if(XGetSelectionOwner(display, atom) != window)
+    {
+        LAL_ERROR("Failed to take selection ownership.");
+        return FAILED;
+    }
+
+    // Ownership moved to us, the server sends no SelectionClear for that
+    handle_selection_clear(platform_handler, atom);
+
+    source->data = data;
+    source->size = size;
+    source->release = release;
+    source->user_data = user_data;
+    source->transfers = 0;
+    source->in_use = TRUE;
+    source->owned = TRUE;
+    clipboard->owned[selection] = source;
+
+    return OK;
+}
+
+void lal_clipboard_clear(PlatformHandler *platform_handler, LalSelection selection)
+{
+    ulong32 window;
+    Display *display = get_x_window(platform_handler, &window);
+    Clipboard *clipboard = get_clipboard(platform_handler, NULL);
+
+    if(clipboard == NULL || (uint32)selection >= LAL_SELECTION_COUNT || clipboard->owned[selection] == NULL)
+        return;
+
+    ulong32 atom = selection_atom(clipboard, selection);
+    XSetSelectionOwner(display, atom, None, selection_time(platform_handler));
+    XFlush(display);
+
+    handle_selection_clear(platform_handler, atom);
+}
+
+void destroy_clipboard(PlatformHandler *platform_handler)
+{
+    Clipboard *clipboard = (Clipboard *)platform_handler->clipboard;
+    if(clipboard == NULL)
+        return;
+
+    // Transfers die with the connection, hand every source back
+    for(uint32 i = 0; i < CLIPBOARD_TRANSFERS; i++)
+        clipboard->transfers[i].source = NULL;
+
+    for(uint32 i = 0; i < CLIPBOARD_SOURCES; i++)
+    {
+        Source *source = &clipboard->sources[i];
+        if(!source->in_use)
+            continue;
+
+        source->owned = FALSE;
+        source->transfers = 0;
+        release_source(source);
+    }
+
+    lal_free(clipboard, sizeof(Clipboard));
+    platform_handler->clipboard = NULL;
+}
+
+#endif // LPLATFORM_LINUX
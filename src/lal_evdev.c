@@ -0,0 +1,71 @@
+#include "lal_evdev.h"
+
+#if LPLATFORM_LINUX
+
+#include <sys/inotify.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+void evdev_scan_devices(EvdevDeviceCallback open_device)
+{
+	DIR *dir = opendir(LAL_EVDEV_DIRECTORY);
+	if(dir == NULL)
+		return;
+
+	char path[LAL_EVDEV_PATH_SIZE];
+	struct dirent *entry;
+	while((entry = readdir(dir)) != NULL)
+	{
+		if(strncmp(entry->d_name, "event", 5) != 0)
+			continue;
+
+		snprintf(path, sizeof(path), "%s/%s", LAL_EVDEV_DIRECTORY, entry->d_name);
+		open_device(path);
+	}
+	closedir(dir);
+}
+
+sint32 evdev_watch_devices()
+{
+	sint32 fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if(fd < 0)
+		return -1;
+
+	// Nodes are created root-only, udev grants access with a later chmod
+	if(inotify_add_watch(fd, LAL_EVDEV_DIRECTORY, IN_CREATE | IN_ATTRIB) < 0)
+	{
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+void evdev_read_hotplug(sint32 watch_fd, EvdevDeviceCallback open_device)
+{
+	char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	char path[LAL_EVDEV_PATH_SIZE];
+
+	for(;;)
+	{
+		ssize_t size = read(watch_fd, buffer, sizeof(buffer));
+		if(size <= 0)
+			return;
+
+		for(char *cursor = buffer; cursor < buffer + size;)
+		{
+			struct inotify_event *event = (struct inotify_event *)cursor;
+			cursor += sizeof(struct inotify_event) + event->len;
+
+			if(event->len == 0 || strncmp(event->name, "event", 5) != 0)
+				continue;
+
+			snprintf(path, sizeof(path), "%s/%s", LAL_EVDEV_DIRECTORY, event->name);
+			open_device(path);
+		}
+	}
+}
+
+#endif // LPLATFORM_LINUX
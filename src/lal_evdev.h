@@ -0,0 +1,37 @@
+#ifndef LAL_EVDEV_H
+#define LAL_EVDEV_H
+
+// Device discovery shared by the evdev readers, not part of the public API.
+// Does not include linux/input.h, its KEY_* macros clash with lal_input.h.
+
+#include "lal_defines.h"
+
+#if LPLATFORM_LINUX
+
+#define LAL_EVDEV_DIRECTORY "/dev/input"
+
+// Room for the directory and any entry name
+#define LAL_EVDEV_PATH_SIZE (sizeof(LAL_EVDEV_DIRECTORY) + 256)
+
+#define BITS_PER_LONG (sizeof(ulong32) * 8)
+#define BIT_WORDS(count) (((count) + BITS_PER_LONG - 1) / BITS_PER_LONG)
+#define TEST_BIT(bits, bit) (((bits)[(bit) / BITS_PER_LONG] >> ((bit) % BITS_PER_LONG)) & 1)
+
+typedef void (*EvdevDeviceCallback)(const char *path);
+
+// Calls open_device for every event node in /dev/input
+void evdev_scan_devices(EvdevDeviceCallback open_device);
+
+// Non-blocking inotify descriptor reporting new event nodes, -1 if hotplug
+// is not available. Removal shows up as ENODEV on the device itself.
+sint32 evdev_watch_devices();
+
+// Calls open_device for every node watch_fd reported since the last call
+void evdev_read_hotplug(sint32 watch_fd, EvdevDeviceCallback open_device);
+
+// Moves the gamepad buttons to the next application frame, from input_publish
+void gamepad_publish();
+
+#endif // LPLATFORM_LINUX
+
+#endif // LAL_EVDEV_H
@@ -0,0 +1,263 @@
+// Fullscreen of the window backends: EWMH state or override-redirect
+// placement on a RandR monitor
+
+#include "lal_defines.h"
+#include "lal_error_list.h"
+#include "lal/lal_window.h"
+#include "lal/lal_monitor.h"
+#include "lal/lal_log.h"
+#include "lal_window_internal.h"
+
+#if LPLATFORM_LINUX
+
+#include <X11/Xatom.h>
+#include <string.h>
+
+// _NET_WM_STATE client message actions
+#define NET_WM_STATE_REMOVE 0
+#define NET_WM_STATE_ADD 1
+
+// Source indication of a normal application
+#define NET_WM_SOURCE_APPLICATION 1
+
+enum
+{
+    ATOM_NET_WM_STATE,
+    ATOM_NET_WM_STATE_FULLSCREEN,
+    ATOM_NET_WM_BYPASS_COMPOSITOR,
+    ATOM_NET_WM_FULLSCREEN_MONITORS,
+    ATOM_COUNT
+};
+
+static char *atom_names[ATOM_COUNT] = {
+    "_NET_WM_STATE",
+    "_NET_WM_STATE_FULLSCREEN",
+    "_NET_WM_BYPASS_COMPOSITOR",
+    "_NET_WM_FULLSCREEN_MONITORS"
+};
+
+typedef struct MonitorRect
+{
+    sint32 x;
+    sint32 y;
+    uint32 width;
+    uint32 height;
+} MonitorRect;
+
+// Falls back to the window's monitor, then the first one, then the screen
+static sint32 find_monitor(PlatformHandler *platform_handler, sint32 monitor, MonitorRect *rect)
+{
+    const LalMonitorTable *table = lal_get_monitors(platform_handler);
+
+    if(monitor < 0 || (uint32)monitor >= table->count)
+        monitor = lal_get_window_monitor(platform_handler);
+    if(monitor < 0 && table->count > 0)
+        monitor = 0;
+
+    if(monitor < 0)
+    {
+        rect->x = 0;
+        rect->y = 0;
+        get_root_size(platform_handler, &rect->width, &rect->height);
+        return -1;
+    }
+
+    rect->x = table->monitors[monitor].x;
+    rect->y = table->monitors[monitor].y;
+    rect->width = table->monitors[monitor].width;
+    rect->height = table->monitors[monitor].height;
+    return monitor;
+}
+
+static void send_wm_message(Display *display, ulong32 window, Atom type, long l0, long l1, long l2, long l3)
+{
+    XEvent message;
+    memset(&message, 0, sizeof(message));
+    message.xclient.type = ClientMessage;
+    message.xclient.window = window;
+    message.xclient.message_type = type;
+    message.xclient.format = 32;
+    message.xclient.data.l[0] = l0;
+    message.xclient.data.l[1] = l1;
+    message.xclient.data.l[2] = l2;
+    message.xclient.data.l[3] = l3;
+    message.xclient.data.l[4] = NET_WM_SOURCE_APPLICATION;
+
+    XSendEvent(display, DefaultRootWindow(display), False,
+        SubstructureRedirectMask | SubstructureNotifyMask, &message);
+}
+
+// 1 asks compositors to unredirect the window, deleting it is no preference
+static void set_bypass_compositor(Display *display, ulong32 window, const Atom *atoms, b8 bypass)
+{
+    if(bypass)
+    {
+        long value = 1;
+        XChangeProperty(display, window, atoms[ATOM_NET_WM_BYPASS_COMPOSITOR], XA_CARDINAL, 32,
+            PropModeReplace, (const uchar8 *)&value, 1);
+    }
+    else
+    {
+        XDeleteProperty(display, window, atoms[ATOM_NET_WM_BYPASS_COMPOSITOR]);
+    }
+}
+
+// _NET_WM_STATE atoms read back from an unmapped window
+#define NET_WM_STATE_LENGTH 32
+
+// Sets the initial state of an unmapped window, keeping its other states
+static void set_initial_fullscreen(Display *display, ulong32 window, const Atom *atoms, b8 fullscreen)
+{
+    Atom states[NET_WM_STATE_LENGTH + 1];
+    uint32 count = 0;
+
+    Atom type;
+    sint32 format;
+    ulong32 items;
+    ulong32 remaining;
+    uchar8 *data = NULL;
+
+    if(XGetWindowProperty(display, window, atoms[ATOM_NET_WM_STATE], 0, NET_WM_STATE_LENGTH, False, XA_ATOM,
+            &type, &format, &items, &remaining, &data) == Success && data != NULL)
+    {
+        if(type == XA_ATOM && format == 32)
+        {
+            for(ulong32 i = 0; i < items; i++)
+            {
+                if(((Atom *)data)[i] != atoms[ATOM_NET_WM_STATE_FULLSCREEN])
+                    states[count++] = ((Atom *)data)[i];
+            }
+        }
+        XFree(data);
+    }
+
+    if(fullscreen)
+        states[count++] = atoms[ATOM_NET_WM_STATE_FULLSCREEN];
+
+    if(count > 0)
+        XChangeProperty(display, window, atoms[ATOM_NET_WM_STATE], XA_ATOM, 32, PropModeReplace,
+            (const uchar8 *)states, (sint32)count);
+    else
+        XDeleteProperty(display, window, atoms[ATOM_NET_WM_STATE]);
+}
+
+// A mapped window asks the window manager, an unmapped one sets the initial state
+static void set_ewmh_fullscreen(PlatformHandler *platform_handler, Display *display, ulong32 window,
+        const Atom *atoms, b8 fullscreen, sint32 monitor, const MonitorRect *rect)
+{
+    if(fullscreen)
+    {
+        // Window managers without _NET_WM_FULLSCREEN_MONITORS use the
+        // monitor the window is on
+        XMoveWindow(display, window, rect->x, rect->y);
+
+        // The message takes Xinerama screen numbers, not table indices
+        sint32 xinerama = get_xinerama_index(platform_handler, monitor);
+        if(xinerama >= 0)
+            send_wm_message(display, window, atoms[ATOM_NET_WM_FULLSCREEN_MONITORS],
+                xinerama, xinerama, xinerama, xinerama);
+    }
+
+    if(platform_handler->mapped)
+    {
+        send_wm_message(display, window, atoms[ATOM_NET_WM_STATE],
+            fullscreen ? NET_WM_STATE_ADD : NET_WM_STATE_REMOVE, (long)atoms[ATOM_NET_WM_STATE_FULLSCREEN], 0, 0);
+    }
+    else
+    {
+        set_initial_fullscreen(display, window, atoms, fullscreen);
+    }
+}
+
+// Override-redirect only applies at map time, the window is remapped. A
+// window handed back to the window manager is only managed after its
+// MapRequest, the EWMH state goes into the property before the map.
+static void set_override_placement(Display *display, ulong32 window, const Atom *atoms, b8 override,
+        b8 ewmh_fullscreen, sint32 x, sint32 y, uint32 width, uint32 height)
+{
+    XSetWindowAttributes attributes;
+    attributes.override_redirect = override ? True : False;
+
+    XUnmapWindow(display, window);
+    XChangeWindowAttributes(display, window, CWOverrideRedirect, &attributes);
+    XMoveResizeWindow(display, window, x, y, width, height);
+    if(!override)
+        set_initial_fullscreen(display, window, atoms, ewmh_fullscreen);
+    XMapRaised(display, window);
+
+    // Without a window manager nobody else hands out the focus
+    if(override)
+        XSetInputFocus(display, window, RevertToParent, CurrentTime);
+}
+
+static void save_windowed_geometry(PlatformHandler *platform_handler, Display *display, ulong32 window)
+{
+    Window child;
+    sint32 x = 0;
+    sint32 y = 0;
+
+    if(XTranslateCoordinates(display, window, DefaultRootWindow(display), 0, 0, &x, &y, &child))
+    {
+        platform_handler->windowed_x = x;
+        platform_handler->windowed_y = y;
+    }
+    platform_handler->windowed_width = platform_handler->width;
+    platform_handler->windowed_height = platform_handler->height;
+}
+
+b8 set_fullscreen(PlatformHandler *platform_handler, FullscreenMode mode, sint32 monitor)
+{
+    ulong32 window;
+    Atom atoms[ATOM_COUNT];
+    MonitorRect rect;
+
+    Display *display = get_x_window(platform_handler, &window);
+    if(display == NULL || (uint32)mode > FULLSCREEN_OVERRIDE)
+        return FAILED;
+
+    if(!XInternAtoms(display, atom_names, ATOM_COUNT, False, atoms))
+        return FAILED;
+
+    monitor = find_monitor(platform_handler, monitor, &rect);
+
+    if(platform_handler->fullscreen_mode == FULLSCREEN_OFF && mode != FULLSCREEN_OFF)
+        save_windowed_geometry(platform_handler, display, window);
+
+    // Leave the current mode first, switching between the two goes through windowed
+    if(platform_handler->fullscreen_mode == FULLSCREEN_EWMH && mode != FULLSCREEN_EWMH)
+        set_ewmh_fullscreen(platform_handler, display, window, atoms, FALSE, monitor, &rect);
+    else if(platform_handler->fullscreen_mode == FULLSCREEN_OVERRIDE && mode == FULLSCREEN_OFF)
+        set_override_placement(display, window, atoms, FALSE, FALSE, platform_handler->windowed_x,
+            platform_handler->windowed_y, platform_handler->windowed_width, platform_handler->windowed_height);
+
+    switch(mode)
+    {
+        case FULLSCREEN_EWMH:
+            // mapped is still TRUE until the remap's events are polled
+            if(platform_handler->fullscreen_mode == FULLSCREEN_OVERRIDE)
+                set_override_placement(display, window, atoms, FALSE, TRUE, rect.x, rect.y, rect.width, rect.height);
+            else
+                set_ewmh_fullscreen(platform_handler, display, window, atoms, TRUE, monitor, &rect);
+            break;
+        case FULLSCREEN_OVERRIDE:
+            set_override_placement(display, window, atoms, TRUE, FALSE, rect.x, rect.y, rect.width, rect.height);
+            break;
+        case FULLSCREEN_OFF:
+        default:
+            break;
+    }
+
+    set_bypass_compositor(display, window, atoms, mode != FULLSCREEN_OFF);
+    XFlush(display);
+
+    platform_handler->fullscreen_mode = mode;
+
+    return OK;
+}
+
+FullscreenMode get_fullscreen(PlatformHandler *platform_handler)
+{
+    return (FullscreenMode)platform_handler->fullscreen_mode;
+}
+
+#endif // LPLATFORM_LINUX
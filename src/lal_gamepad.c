@@ -0,0 +1,505 @@
+#include "lal_defines.h"
+#include "lal_error_list.h"
+#include "lal/lal_gamepad.h"
+#include "lal/lal_window.h"
+#include "lal/lal_log.h"
+#include "lal_evdev.h"
+
+#if LPLATFORM_LINUX
+
+// linux/input.h defines KEY_* macros that clash with the Keys enum, this
+// file must not include lal_input.h
+#include <linux/input.h>
+
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+// epoll tag of the inotify descriptor, pads use their index
+#define HOTPLUG_TAG LAL_MAX_GAMEPADS
+
+// input_events read per read(2)
+#define LAL_GAMEPAD_EVENT_BATCH 64
+
+typedef struct AxisRange
+{
+	sint32 minimum;
+	sint32 maximum;
+	sint32 flat;
+} AxisRange;
+
+// Per-device data that the state array does not need
+typedef struct PadDevice
+{
+	sint32 fd;
+
+	// Set by SYN_DROPPED, the state is reread at the next SYN_REPORT
+	b8 dropped;
+
+	// Changes since the last SYN_REPORT
+	uint32 pending_buttons;
+	sshort16 pending_axes[LAL_GAMEPAD_AXIS_COUNT];
+
+	// As of the last SYN_REPORT, and presses since the last publish so a
+	// tap inside one application frame still reads as down for a frame
+	uint32 buttons;
+	uint32 pressed;
+
+	AxisRange ranges[LAL_GAMEPAD_AXIS_COUNT];
+	char path[LAL_EVDEV_PATH_SIZE];
+} PadDevice;
+
+typedef struct AxisCode
+{
+	ushort16 code;
+	uchar8 axis;
+} AxisCode;
+
+// Triggers are ABS_Z/ABS_RZ on most pads, ABS_BRAKE/ABS_GAS on some
+static const AxisCode axis_codes[] = {
+	{ ABS_X, LAL_GAMEPAD_AXIS_LEFT_X },
+	{ ABS_Y, LAL_GAMEPAD_AXIS_LEFT_Y },
+	{ ABS_RX, LAL_GAMEPAD_AXIS_RIGHT_X },
+	{ ABS_RY, LAL_GAMEPAD_AXIS_RIGHT_Y },
+	{ ABS_Z, LAL_GAMEPAD_AXIS_LEFT_TRIGGER },
+	{ ABS_RZ, LAL_GAMEPAD_AXIS_RIGHT_TRIGGER },
+	{ ABS_BRAKE, LAL_GAMEPAD_AXIS_LEFT_TRIGGER },
+	{ ABS_GAS, LAL_GAMEPAD_AXIS_RIGHT_TRIGGER },
+};
+
+static LalGamepad pads[LAL_MAX_GAMEPADS];
+static PadDevice devices[LAL_MAX_GAMEPADS];
+static sint32 epoll_fd = -1;
+static sint32 inotify_fd = -1;
+
+static sint32 map_button(uint32 code)
+{
+	switch(code)
+	{
+		case BTN_SOUTH: return LAL_GAMEPAD_BUTTON_SOUTH;
+		case BTN_EAST: return LAL_GAMEPAD_BUTTON_EAST;
+		case BTN_WEST: return LAL_GAMEPAD_BUTTON_WEST;
+		case BTN_NORTH: return LAL_GAMEPAD_BUTTON_NORTH;
+		case BTN_TL: return LAL_GAMEPAD_BUTTON_LEFT_SHOULDER;
+		case BTN_TR: return LAL_GAMEPAD_BUTTON_RIGHT_SHOULDER;
+		case BTN_SELECT: return LAL_GAMEPAD_BUTTON_BACK;
+		case BTN_START: return LAL_GAMEPAD_BUTTON_START;
+		case BTN_MODE: return LAL_GAMEPAD_BUTTON_GUIDE;
+		case BTN_THUMBL: return LAL_GAMEPAD_BUTTON_LEFT_STICK;
+		case BTN_THUMBR: return LAL_GAMEPAD_BUTTON_RIGHT_STICK;
+		case BTN_DPAD_UP: return LAL_GAMEPAD_BUTTON_DPAD_UP;
+		case BTN_DPAD_DOWN: return LAL_GAMEPAD_BUTTON_DPAD_DOWN;
+		case BTN_DPAD_LEFT: return LAL_GAMEPAD_BUTTON_DPAD_LEFT;
+		case BTN_DPAD_RIGHT: return LAL_GAMEPAD_BUTTON_DPAD_RIGHT;
+		default:
+			break;
+	}
+
+	// Plain joysticks number their buttons from BTN_TRIGGER
+	if(code >= BTN_TRIGGER && code <= BTN_BASE6)
+		return (sint32)(code - BTN_TRIGGER);
+
+	return -1;
+}
+
+static sint32 map_axis(uint32 code)
+{
+	for(uint32 i = 0; i < sizeof(axis_codes) / sizeof(axis_codes[0]); i++)
+	{
+		if(axis_codes[i].code == code)
+			return axis_codes[i].axis;
+	}
+
+	return -1;
+}
+
+static sshort16 normalize_axis(const AxisRange *range, sint32 value, b8 trigger)
+{
+	sllong64 span = (sllong64)range->maximum - range->minimum;
+	if(span <= 0)
+		return 0;
+
+	sllong64 offset = (sllong64)value - range->minimum;
+	if(offset < 0)
+		offset = 0;
+	if(offset > span)
+		offset = span;
+
+	if(trigger)
+		return (sshort16)(offset * 32767 / span);
+
+	sllong64 center = span / 2;
+	if(offset - center <= range->flat && center - offset <= range->flat)
+		return 0;
+
+	return (sshort16)(offset * 65534 / span - 32767);
+}
+
+static void set_button(uint32 *buttons, sint32 button, b8 down)
+{
+	if(down)
+		*buttons |= 1u << button;
+	else
+		*buttons &= ~(1u << button);
+}
+
+// Decodes one event into the pending state of the pad
+static void apply_event(PadDevice *device, uint32 type, uint32 code, sint32 value)
+{
+	sint32 index;
+
+	switch(type)
+	{
+		case EV_KEY:
+			// 2 is autorepeat, the button is already down
+			index = map_button(code);
+			if(index >= 0 && value != 2)
+				set_button(&device->pending_buttons, index, value != 0);
+			break;
+		case EV_ABS:
+			if(code == ABS_HAT0X)
+			{
+				set_button(&device->pending_buttons, LAL_GAMEPAD_BUTTON_DPAD_LEFT, value < 0);
+				set_button(&device->pending_buttons, LAL_GAMEPAD_BUTTON_DPAD_RIGHT, value > 0);
+				break;
+			}
+			if(code == ABS_HAT0Y)
+			{
+				set_button(&device->pending_buttons, LAL_GAMEPAD_BUTTON_DPAD_UP, value < 0);
+				set_button(&device->pending_buttons, LAL_GAMEPAD_BUTTON_DPAD_DOWN, value > 0);
+				break;
+			}
+
+			index = map_axis(code);
+			if(index >= 0)
+				device->pending_axes[index] = normalize_axis(&device->ranges[index], value,
+					index >= LAL_GAMEPAD_AXIS_LEFT_TRIGGER);
+			break;
+		default:
+			break;
+	}
+}
+
+static void commit_frame(uint32 pad)
+{
+	PadDevice *device = &devices[pad];
+	device->pressed |= device->pending_buttons & ~device->buttons;
+	device->buttons = device->pending_buttons;
+	memcpy(pads[pad].axes, device->pending_axes, sizeof(pads[pad].axes));
+}
+
+// Rereads the full device state, used after open and after SYN_DROPPED
+static void resync(uint32 pad)
+{
+	PadDevice *device = &devices[pad];
+	ulong32 keys[BIT_WORDS(KEY_CNT)] = { 0 };
+
+	if(ioctl(device->fd, EVIOCGKEY(sizeof(keys)), keys) < 0)
+		return;
+
+	device->pending_buttons = 0;
+	for(uint32 code = BTN_JOYSTICK; code <= BTN_THUMBR; code++)
+		apply_event(device, EV_KEY, code, (sint32)TEST_BIT(keys, code));
+	for(uint32 code = BTN_DPAD_UP; code <= BTN_DPAD_RIGHT; code++)
+		apply_event(device, EV_KEY, code, (sint32)TEST_BIT(keys, code));
+
+	struct input_absinfo info;
+	for(uint32 code = 0; code < ABS_CNT; code++)
+	{
+		if((map_axis(code) >= 0 || code == ABS_HAT0X || code == ABS_HAT0Y)
+				&& ioctl(device->fd, EVIOCGABS(code), &info) >= 0)
+			apply_event(device, EV_ABS, code, info.value);
+	}
+
+	commit_frame(pad);
+}
+
+static void close_pad(uint32 pad)
+{
+	PadDevice *device = &devices[pad];
+
+	epoll_ctl(epoll_fd, EPOLL_CTL_DEL, device->fd, NULL);
+	close(device->fd);
+
+	LAL_INFO("Gamepad %u disconnected: %s", pad, device->path);
+
+	device->fd = -1;
+	device->path[0] = '\0';
+	device->buttons = 0;
+	device->pressed = 0;
+	memset(&pads[pad], 0, sizeof(LalGamepad));
+}
+
+// require_gamepad skips devices without gamepad or joystick buttons
+static sint32 open_pad(const char *path, b8 require_gamepad)
+{
+	sint32 pad = -1;
+	for(uint32 i = 0; i < LAL_MAX_GAMEPADS; i++)
+	{
+		if(devices[i].fd >= 0 && strcmp(devices[i].path, path) == 0)
+			return (sint32)i;
+		if(devices[i].fd < 0 && pad < 0)
+			pad = (sint32)i;
+	}
+
+	if(pad < 0)
+		return -1;
+
+	sint32 fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+	if(fd < 0)
+		return -1;
+
+	ulong32 key_bits[BIT_WORDS(KEY_CNT)] = { 0 };
+	b8 is_evdev = ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(key_bits)), key_bits) >= 0;
+	b8 is_gamepad = is_evdev && (TEST_BIT(key_bits, BTN_GAMEPAD) || TEST_BIT(key_bits, BTN_JOYSTICK));
+
+	if(require_gamepad && !is_gamepad)
+	{
+		close(fd);
+		return -1;
+	}
+
+	PadDevice *device = &devices[pad];
+	memset(device, 0, sizeof(PadDevice));
+	device->fd = fd;
+	snprintf(device->path, sizeof(device->path), "%s", path);
+
+	// Defaults for streams without EVIOCGABS, the xpad ranges
+	for(uint32 i = 0; i < LAL_GAMEPAD_AXIS_COUNT; i++)
+	{
+		b8 trigger = i >= LAL_GAMEPAD_AXIS_LEFT_TRIGGER;
+		device->ranges[i].minimum = trigger ? 0 : -32768;
+		device->ranges[i].maximum = trigger ? 255 : 32767;
+		device->ranges[i].flat = trigger ? 0 : 128;
+	}
+
+	struct input_absinfo info;
+	for(uint32 i = 0; is_evdev && i < sizeof(axis_codes) / sizeof(axis_codes[0]); i++)
+	{
+		if(ioctl(fd, EVIOCGABS(axis_codes[i].code), &info) < 0 || info.maximum <= info.minimum)
+			continue;
+
+		AxisRange *range = &device->ranges[axis_codes[i].axis];
+		range->minimum = info.minimum;
+		range->maximum = info.maximum;
+		range->flat = info.flat;
+	}
+
+	struct epoll_event event;
+	event.events = EPOLLIN;
+	event.data.u32 = (uint32)pad;
+	if(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0)
+	{
+		close(fd);
+		device->fd = -1;
+		return -1;
+	}
+
+	memset(&pads[pad], 0, sizeof(LalGamepad));
+	pads[pad].connected = TRUE;
+
+	if(is_evdev)
+		resync((uint32)pad);
+
+	char name[64] = "unknown";
+	if(is_evdev)
+		ioctl(fd, EVIOCGNAME(sizeof(name)), name);
+
+	LAL_INFO("Gamepad %d connected: %s (%s)", pad, name, path);
+
+	return pad;
+}
+
+static void read_pad(uint32 pad)
+{
+	PadDevice *device = &devices[pad];
+	struct input_event events[LAL_GAMEPAD_EVENT_BATCH];
+
+	for(;;)
+	{
+		ssize_t size = read(device->fd, events, sizeof(events));
+		if(size < 0 && errno == EINTR)
+			continue;
+		if(size < 0 && errno == EAGAIN)
+			return;
+
+		// ENODEV once unplugged, end of file for recorded streams
+		if(size <= 0)
+		{
+			close_pad(pad);
+			return;
+		}
+
+		size_t count = (size_t)size / sizeof(struct input_event);
+		for(size_t i = 0; i < count; i++)
+		{
+			struct input_event *event = &events[i];
+
+			if(event->type == EV_SYN && event->code == SYN_DROPPED)
+			{
+				device->dropped = TRUE;
+			}
+			else if(event->type == EV_SYN && event->code == SYN_REPORT)
+			{
+				if(device->dropped)
+				{
+					device->dropped = FALSE;
+					resync(pad);
+				}
+				else
+				{
+					commit_frame(pad);
+				}
+			}
+			else if(!device->dropped)
+			{
+				apply_event(device, event->type, event->code, event->value);
+			}
+		}
+	}
+}
+
+static void open_new_pad(const char *path)
+{
+	open_pad(path, TRUE);
+}
+
+static void dispatch_gamepads(void *user_data)
+{
+	lal_gamepad_poll();
+}
+
+b8 lal_gamepad_initialize()
+{
+	if(epoll_fd >= 0)
+		return OK;
+
+	for(uint32 i = 0; i < LAL_MAX_GAMEPADS; i++)
+	{
+		devices[i].fd = -1;
+		memset(&pads[i], 0, sizeof(LalGamepad));
+	}
+
+	epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if(epoll_fd < 0)
+	{
+		LAL_ERROR("Failed to create gamepad epoll descriptor.");
+		return FAILED;
+	}
+
+	inotify_fd = evdev_watch_devices();
+	if(inotify_fd >= 0)
+	{
+		struct epoll_event event;
+		event.events = EPOLLIN;
+		event.data.u32 = HOTPLUG_TAG;
+		epoll_ctl(epoll_fd, EPOLL_CTL_ADD, inotify_fd, &event);
+	}
+	else
+	{
+		LAL_WARN("Gamepad hotplug is not available.");
+	}
+
+	evdev_scan_devices(open_new_pad);
+
+	return add_wait_source(epoll_fd, dispatch_gamepads, NULL);
+}
+
+void lal_gamepad_shutdown()
+{
+	if(epoll_fd < 0)
+		return;
+
+	remove_wait_source(epoll_fd);
+
+	for(uint32 i = 0; i < LAL_MAX_GAMEPADS; i++)
+	{
+		if(devices[i].fd >= 0)
+			close_pad(i);
+	}
+
+	if(inotify_fd >= 0)
+		close(inotify_fd);
+	close(epoll_fd);
+
+	inotify_fd = -1;
+	epoll_fd = -1;
+}
+
+sint32 lal_gamepad_open(const char *path)
+{
+	if(epoll_fd < 0)
+		return -1;
+
+	return open_pad(path, FALSE);
+}
+
+void gamepad_publish()
+{
+	for(uint32 pad = 0; pad < LAL_MAX_GAMEPADS; pad++)
+	{
+		pads[pad].previous_buttons = pads[pad].buttons;
+		pads[pad].buttons = devices[pad].buttons | devices[pad].pressed;
+		devices[pad].pressed = 0;
+	}
+}
+
+void lal_gamepad_poll()
+{
+	struct epoll_event ready[LAL_MAX_GAMEPADS + 1];
+
+	if(epoll_fd < 0)
+		return;
+
+	sint32 count = epoll_wait(epoll_fd, ready, LAL_MAX_GAMEPADS + 1, 0);
+	for(sint32 i = 0; i < count; i++)
+	{
+		if(ready[i].data.u32 == HOTPLUG_TAG)
+			evdev_read_hotplug(inotify_fd, open_new_pad);
+		else if(devices[ready[i].data.u32].fd >= 0)
+			read_pad(ready[i].data.u32);
+	}
+}
+
+sint32 lal_gamepad_fd()
+{
+	return epoll_fd;
+}
+
+const LalGamepad *lal_gamepad_get(uint32 pad)
+{
+	if(pad >= LAL_MAX_GAMEPADS)
+		return NULL;
+
+	return &pads[pad];
+}
+
+b8 lal_gamepad_is_button_down(uint32 pad, LalGamepadButton button)
+{
+	if(pad >= LAL_MAX_GAMEPADS)
+		return FALSE;
+
+	return (pads[pad].buttons >> button) & 1;
+}
+
+b8 lal_gamepad_was_button_down(uint32 pad, LalGamepadButton button)
+{
+	if(pad >= LAL_MAX_GAMEPADS)
+		return FALSE;
+
+	return (pads[pad].previous_buttons >> button) & 1;
+}
+
+sshort16 lal_gamepad_axis(uint32 pad, LalGamepadAxis axis)
+{
+	if(pad >= LAL_MAX_GAMEPADS || axis >= LAL_GAMEPAD_AXIS_COUNT)
+		return 0;
+
+	return pads[pad].axes[axis];
+}
+
+#endif // LPLATFORM_LINUX
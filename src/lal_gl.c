@@ -0,0 +1,91 @@
+#include "lal_defines.h"
+#include "lal_error_list.h"
+#include "lal/lal_gl.h"
+#include "lal/lal_log.h"
+
+#if LPLATFORM_LINUX
+
+// Lazy stubs: resolve and forward the call. Only lal_gl_load() patches the
+// table, before any render thread runs, so calls never race on it.
+#define LAL_GL_LAZY_STUB(ret, name, params, args) \
+	static ret APIENTRY lazy_##name params \
+	{ \
+		ret (APIENTRYP proc) params = (ret (APIENTRYP) params)lal_gl_get_proc_address(#name); \
+		if(proc == NULL) \
+		{ \
+			LAL_ERROR("Failed to resolve %s.", #name); \
+			return (ret)0; \
+		} \
+		return proc args; \
+	}
+
+#define LAL_GL_LAZY_VOID_STUB(name, params, args) \
+	static void APIENTRY lazy_##name params \
+	{ \
+		void (APIENTRYP proc) params = (void (APIENTRYP) params)lal_gl_get_proc_address(#name); \
+		if(proc == NULL) \
+		{ \
+			LAL_ERROR("Failed to resolve %s.", #name); \
+			return; \
+		} \
+		proc args; \
+	}
+
+LAL_GL_LAZY_FUNCS(LAL_GL_LAZY_STUB, LAL_GL_LAZY_VOID_STUB)
+
+#define LAL_GL_EAGER_INIT(ret, name, params) .name = NULL,
+#define LAL_GL_LAZY_INIT(ret, name, params, args) .name = lazy_##name,
+#define LAL_GL_LAZY_VOID_INIT(name, params, args) .name = lazy_##name,
+
+LalGLDispatch lal_gl = {
+	LAL_GL_EAGER_FUNCS(LAL_GL_EAGER_INIT)
+	LAL_GL_LAZY_FUNCS(LAL_GL_LAZY_INIT, LAL_GL_LAZY_VOID_INIT)
+};
+
+static b8 gl_loaded = FALSE;
+
+LalGLProc lal_gl_get_proc_address(const char *name)
+{
+	return (LalGLProc)glXGetProcAddressARB((const GLubyte *)name);
+}
+
+b8 lal_gl_load()
+{
+	if(gl_loaded)
+		return OK;
+
+	#define LAL_GL_EAGER_LOAD(ret, name, params) \
+		lal_gl.name = (ret (APIENTRYP) params)lal_gl_get_proc_address(#name);
+
+	LAL_GL_EAGER_FUNCS(LAL_GL_EAGER_LOAD)
+
+	#undef LAL_GL_EAGER_LOAD
+
+	// Core GLX 1.3 entries must always be present
+	if(lal_gl.glXMakeContextCurrent == NULL || lal_gl.glXSwapBuffers == NULL)
+	{
+		LAL_ERROR("Failed to load GLX entry points.");
+		return CONTEXT_ERROR;
+	}
+
+	// GLX hands out GL entries without a current context. Unresolved ones
+	// keep their stub, which reports the error at the call.
+	#define LAL_GL_LAZY_LOAD(ret, name, params, args) \
+		{ \
+			ret (APIENTRYP proc) params = (ret (APIENTRYP) params)lal_gl_get_proc_address(#name); \
+			if(proc != NULL) \
+				lal_gl.name = proc; \
+		}
+	#define LAL_GL_LAZY_VOID_LOAD(name, params, args) LAL_GL_LAZY_LOAD(void, name, params, args)
+
+	LAL_GL_LAZY_FUNCS(LAL_GL_LAZY_LOAD, LAL_GL_LAZY_VOID_LOAD)
+
+	#undef LAL_GL_LAZY_VOID_LOAD
+	#undef LAL_GL_LAZY_LOAD
+
+	gl_loaded = TRUE;
+
+	return OK;
+}
+
+#endif // LPLATFORM_LINUX
@@ -1,6 +1,9 @@
 #include "lal/lal_input.h"
-#include <stdlib.h>
+#include "lal/lal_memory.h"
+#include "lal_evdev.h"
 #include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
 
 typedef struct Keyboard
 {
@@ -19,20 +22,192 @@ typedef struct InputState
 	Keyboard keyboard_previous;
 	Mouse mouse_current;
 	Mouse mouse_previous;
+	ushort16 key_repeats[256];
+
+	TouchTable touches;
+
+	// Bits per slot changed by events since the last publish
+	uint32 touch_live;
+	uint32 touch_moved;
+	uint32 touch_pending_end;
+
+	// Indexed by device id, device_ids lists the ones in use
+	DeviceInput *devices[LAL_MAX_INPUT_DEVICES];
+	ushort16 device_ids[LAL_MAX_INPUT_DEVICES];
+	uint32 device_count;
 } InputState;
 
 static InputState *input_state;
 
+// Windows sharing input_state, the last input_shutdown frees it
+static uint32 input_users;
+
+// Seqlock around the published snapshot: odd while a publish is in progress
+static struct
+{
+	atomic_uint sequence;
+	InputSnapshot snapshot;
+} published;
+
 void input_initialize()
 {
-	input_state = malloc(sizeof(InputState));	
+	// Reuse the state when several windows initialize input
+	if(input_state != NULL)
+	{
+		input_users++;
+		return;
+	}
+
+	input_state = lal_allocate(sizeof(InputState));
+	if(input_state == NULL)
+		return;
+
+	input_users = 1;
+	memset(input_state->devices, 0, sizeof(input_state->devices));
+	input_state->device_count = 0;
 
 	for(int i = 0; i < 256; i++)
 	{
 		input_state->keyboard_current.keys[i] = FALSE;
 		input_state->keyboard_previous.keys[i] = FALSE;
-	
+		input_state->key_repeats[i] = 0;
 	}
+
+	memset(&input_state->touches, 0, sizeof(TouchTable));
+	input_state->touch_live = 0;
+	input_state->touch_moved = 0;
+	input_state->touch_pending_end = 0;
+}
+
+static void set_bit(ullong64 *bits, uint32 bit, b8 value)
+{
+	if(value)
+		bits[bit >> 6] |= 1ull << (bit & 63);
+	else
+		bits[bit >> 6] &= ~(1ull << (bit & 63));
+}
+
+static DeviceInput *find_device(uint32 id)
+{
+	if(!input_state || id >= LAL_MAX_INPUT_DEVICES)
+		return NULL;
+
+	return input_state->devices[id];
+}
+
+// Frame edges of the per-device state, like the touch table
+static void commit_devices()
+{
+	for(uint32 i = 0; i < input_state->device_count; i++)
+	{
+		DeviceInput *device = input_state->devices[input_state->device_ids[i]];
+		memcpy(device->previous_keys, device->keys, sizeof(device->keys));
+		device->previous_buttons = device->buttons;
+	}
+}
+
+static b8 snapshot_bit(const ullong64 *bits, Keys key)
+{
+	return (bits[(uint32)key >> 6] >> ((uint32)key & 63)) & 1;
+}
+
+// Turns the touch events of the batch into this frame's down bits and phases
+static void commit_touches()
+{
+	TouchTable *touches = &input_state->touches;
+
+	touches->previous_down = touches->down;
+	touches->down = input_state->touch_live;
+
+	for(uint32 slot = 0; slot < LAL_MAX_TOUCHES; slot++)
+	{
+		b8 now = (touches->down >> slot) & 1;
+		b8 before = (touches->previous_down >> slot) & 1;
+
+		if(now && !before)
+			touches->phases[slot] = TOUCH_PHASE_BEGAN;
+		else if(now)
+			touches->phases[slot] = (input_state->touch_moved >> slot) & 1 ? TOUCH_PHASE_MOVED : TOUCH_PHASE_STATIONARY;
+		else if(before)
+			touches->phases[slot] = TOUCH_PHASE_ENDED;
+		else
+			touches->phases[slot] = TOUCH_PHASE_NONE;
+	}
+
+	input_state->touch_live &= ~input_state->touch_pending_end;
+	input_state->touch_pending_end = 0;
+	input_state->touch_moved = 0;
+}
+
+void input_publish()
+{
+#if LPLATFORM_LINUX
+	gamepad_publish();
+#endif
+
+	if(!input_state)
+		return;
+
+	commit_touches();
+	commit_devices();
+
+	// Build outside the critical section to keep it short
+	InputSnapshot next;
+	memset(&next, 0, sizeof(next));
+	memcpy(next.previous_keys, published.snapshot.keys, sizeof(next.previous_keys));
+	for(uint32 i = 0; i < 256; i++)
+	{
+		if(input_state->keyboard_current.keys[i])
+			next.keys[i >> 6] |= 1ull << (i & 63);
+	}
+	next.mouse_x = input_state->mouse_current.x;
+	next.mouse_y = input_state->mouse_current.y;
+	next.frame = published.snapshot.frame + 1;
+
+	uint32 sequence = atomic_load_explicit(&published.sequence, memory_order_relaxed);
+	atomic_store_explicit(&published.sequence, sequence + 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+
+	// Readers overlapping this copy see a changed sequence and retry
+	published.snapshot = next;
+
+	atomic_store_explicit(&published.sequence, sequence + 2, memory_order_release);
+}
+
+void input_read_snapshot(InputSnapshot *snapshot)
+{
+	uint32 before;
+	uint32 after;
+
+	do
+	{
+		before = atomic_load_explicit(&published.sequence, memory_order_acquire);
+		*snapshot = published.snapshot;
+		atomic_thread_fence(memory_order_acquire);
+		after = atomic_load_explicit(&published.sequence, memory_order_relaxed);
+	} while(before != after || (before & 1));
+}
+
+b8 snapshot_is_key_down(const InputSnapshot *snapshot, Keys key)
+{
+	return snapshot_bit(snapshot->keys, key);
+}
+
+b8 snapshot_was_key_down(const InputSnapshot *snapshot, Keys key)
+{
+	return snapshot_bit(snapshot->previous_keys, key);
+}
+
+void input_shutdown()
+{
+	if(input_state == NULL || --input_users > 0)
+		return;
+
+	while(input_state && input_state->device_count > 0)
+		input_remove_device(input_state->device_ids[0]);
+
+	lal_free(input_state, sizeof(InputState));
+	input_state = NULL;
 }
 
 b8 is_key_down(Keys key)
@@ -67,10 +242,230 @@ b8 was_key_up(Keys key)
 	return input_state->keyboard_current.keys[key] == FALSE;
 }
 
+ushort16 get_key_repeat_count(Keys key)
+{
+	if(!input_state)
+		return 0;
+
+	return input_state->key_repeats[key];
+}
+
 void input_process_key(Keys key, b8 pressed)
 {
-	if(input_state && input_state->keyboard_current.keys[key] != pressed)
+	if(!input_state)
+		return;
+
+	// A press on a held key is an auto-repeat, count it instead of toggling
+	if(pressed && input_state->keyboard_current.keys[key])
+	{
+		if(input_state->key_repeats[key] < 0xFFFF)
+			input_state->key_repeats[key]++;
+		return;
+	}
+
+	if(input_state->keyboard_current.keys[key] != pressed)
+	{
 		input_state->keyboard_current.keys[key] = pressed;
+		input_state->key_repeats[key] = 0;
+	}
+}
+
+void input_process_mouse_move(sshort16 x, sshort16 y)
+{
+	if(!input_state)
+		return;
+
+	input_state->mouse_current.x = x;
+	input_state->mouse_current.y = y;
+}
+
+void input_process_touch(uint32 id, TouchPhase phase, sshort16 x, sshort16 y)
+{
+	if(!input_state)
+		return;
+
+	TouchTable *touches = &input_state->touches;
+
+	sint32 slot = -1;
+	for(uint32 i = 0; i < LAL_MAX_TOUCHES; i++)
+	{
+		if(((input_state->touch_live >> i) & 1) && touches->ids[i] == id)
+		{
+			slot = (sint32)i;
+			break;
+		}
+	}
+
+	if(slot < 0 && phase == TOUCH_PHASE_BEGAN)
+	{
+		// Slots still reported down this frame are not free yet
+		uint32 used = input_state->touch_live | touches->down;
+		for(uint32 i = 0; i < LAL_MAX_TOUCHES && slot < 0; i++)
+		{
+			if(!((used >> i) & 1))
+				slot = (sint32)i;
+		}
+
+		if(slot < 0)
+			return;
+
+		touches->ids[slot] = id;
+		input_state->touch_live |= 1u << slot;
+	}
+
+	if(slot < 0)
+		return;
+
+	touches->x[slot] = x;
+	touches->y[slot] = y;
+
+	if(phase == TOUCH_PHASE_MOVED)
+	{
+		input_state->touch_moved |= 1u << slot;
+	}
+	else if(phase == TOUCH_PHASE_ENDED)
+	{
+		// Ended before any frame saw it down, keep it for one frame
+		if((touches->down >> slot) & 1)
+			input_state->touch_live &= ~(1u << slot);
+		else
+			input_state->touch_pending_end |= 1u << slot;
+	}
+}
+
+const TouchTable *get_touch_table()
+{
+	if(!input_state)
+		return NULL;
+
+	return &input_state->touches;
+}
+
+b8 is_touch_down(uint32 slot)
+{
+	if(!input_state || slot >= LAL_MAX_TOUCHES)
+		return FALSE;
+
+	return (input_state->touches.down >> slot) & 1;
+}
+
+b8 was_touch_down(uint32 slot)
+{
+	if(!input_state || slot >= LAL_MAX_TOUCHES)
+		return FALSE;
+
+	return (input_state->touches.previous_down >> slot) & 1;
+}
+
+void input_add_device(uint32 id, InputDeviceType type, uint32 master, const char *name)
+{
+	if(!input_state || id >= LAL_MAX_INPUT_DEVICES)
+		return;
+
+	DeviceInput *device = input_state->devices[id];
+	if(device == NULL)
+	{
+		device = lal_allocate(sizeof(DeviceInput));
+		if(device == NULL)
+			return;
+
+		memset(device, 0, sizeof(DeviceInput));
+		device->id = id;
+		input_state->devices[id] = device;
+		input_state->device_ids[input_state->device_count++] = (ushort16)id;
+	}
+
+	device->type = type;
+	device->master = master;
+	snprintf(device->name, sizeof(device->name), "%s", name);
+}
+
+void input_remove_device(uint32 id)
+{
+	DeviceInput *device = find_device(id);
+	if(device == NULL)
+		return;
+
+	for(uint32 i = 0; i < input_state->device_count; i++)
+	{
+		if(input_state->device_ids[i] == id)
+		{
+			input_state->device_ids[i] = input_state->device_ids[--input_state->device_count];
+			break;
+		}
+	}
+
+	input_state->devices[id] = NULL;
+	lal_free(device, sizeof(DeviceInput));
+}
+
+void input_process_device_key(uint32 id, Keys key, b8 pressed)
+{
+	DeviceInput *device = find_device(id);
+	if(device != NULL)
+		set_bit(device->keys, (uint32)key, pressed);
+}
+
+void input_process_device_button(uint32 id, Buttons button, b8 pressed)
+{
+	DeviceInput *device = find_device(id);
+	if(device == NULL)
+		return;
+
+	if(pressed)
+		device->buttons |= 1u << button;
+	else
+		device->buttons &= ~(1u << button);
+}
+
+void input_process_device_motion(uint32 id, sshort16 x, sshort16 y)
+{
+	DeviceInput *device = find_device(id);
+	if(device == NULL)
+		return;
+
+	device->mouse_x = x;
+	device->mouse_y = y;
+}
+
+const DeviceInput *get_device_input(uint32 id)
+{
+	return find_device(id);
+}
+
+uint32 get_input_devices(uint32 *ids, uint32 capacity)
+{
+	if(!input_state)
+		return 0;
+
+	for(uint32 i = 0; i < input_state->device_count && i < capacity; i++)
+		ids[i] = input_state->device_ids[i];
+
+	return input_state->device_count;
+}
+
+b8 is_device_key_down(uint32 id, Keys key)
+{
+	DeviceInput *device = find_device(id);
+	return device != NULL && snapshot_bit(device->keys, key);
+}
+
+b8 was_device_key_down(uint32 id, Keys key)
+{
+	DeviceInput *device = find_device(id);
+	return device != NULL && snapshot_bit(device->previous_keys, key);
+}
+
+b8 is_device_button_down(uint32 id, Buttons button)
+{
+	DeviceInput *device = find_device(id);
+	return device != NULL && ((device->buttons >> button) & 1);
+}
+
+b8 was_device_button_down(uint32 id, Buttons button)
+{
+	DeviceInput *device = find_device(id);
+	return device != NULL && ((device->previous_buttons >> button) & 1);
 }
 
 void input_update()
@@ -0,0 +1,294 @@
+#include "lal_defines.h"
+#include "lal_error_list.h"
+#include "lal/lal_log.h"
+
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <time.h>
+#include <unistd.h>
+
+// Ring slots, must be a power of two
+#define LAL_LOG_RING_SIZE 256
+
+// Longer messages are truncated
+#define LAL_LOG_MESSAGE_SIZE 240
+
+// Lines are batched into one write of up to this size
+#define LAL_LOG_WRITE_BUFFER 4096
+
+enum
+{
+	WRITER_STOPPED,
+	WRITER_STARTING,
+	WRITER_RUNNING
+};
+
+// A slot is free for position p when sequence == p and holds the
+// message for p once sequence == p + 1
+typedef struct LogSlot
+{
+	atomic_size_t sequence;
+	uint32 level;
+	char message[LAL_LOG_MESSAGE_SIZE];
+} LogSlot;
+
+typedef struct LogState
+{
+	LogSlot slots[LAL_LOG_RING_SIZE];
+	atomic_size_t enqueue_position;
+	atomic_size_t dequeue_position;
+	atomic_ullong dropped;
+
+	atomic_uint level;
+	atomic_int writer_state;
+	atomic_int stop;
+	sem_t pending;
+	pthread_t writer;
+
+	LalLogSink sink;
+	void *sink_user_data;
+} LogState;
+
+static LogState log_state = {
+	.level = LAL_LOG_INFO,
+	.writer_state = WRITER_STOPPED,
+};
+
+static pthread_once_t ring_once = PTHREAD_ONCE_INIT;
+
+static const char *level_prefix(uint32 level)
+{
+	switch(level)
+	{
+		case LAL_LOG_ERROR: return "ERROR: ";
+		case LAL_LOG_WARN: return "WARNING: ";
+		case LAL_LOG_INFO: return "INFO: ";
+		case LAL_LOG_DEBUG: return "DEBUG: ";
+		default: return "";
+	}
+}
+
+static void initialize_ring()
+{
+	for(size_t i = 0; i < LAL_LOG_RING_SIZE; i++)
+		atomic_init(&log_state.slots[i].sequence, i);
+
+	sem_init(&log_state.pending, 0, 0);
+}
+
+static void write_all(const char *data, size_t size)
+{
+	while(size > 0)
+	{
+		ssize_t written = write(STDERR_FILENO, data, size);
+		if(written <= 0)
+			return;
+
+		data += written;
+		size -= (size_t)written;
+	}
+}
+
+// Appends a line to the batch, writing the batch out first if it is full
+static void emit(char *batch, size_t *batch_size, uint32 level, const char *message)
+{
+	if(log_state.sink != NULL)
+	{
+		log_state.sink(log_state.sink_user_data, (LalLogLevel)level, message);
+		return;
+	}
+
+	char line[LAL_LOG_MESSAGE_SIZE + 16];
+	sint32 length = snprintf(line, sizeof(line), "%s%s\n", level_prefix(level), message);
+	if(length <= 0)
+		return;
+
+	size_t line_size = (size_t)length < sizeof(line) ? (size_t)length : sizeof(line) - 1;
+	if(*batch_size + line_size > LAL_LOG_WRITE_BUFFER)
+	{
+		write_all(batch, *batch_size);
+		*batch_size = 0;
+	}
+
+	memcpy(batch + *batch_size, line, line_size);
+	*batch_size += line_size;
+}
+
+// Writes every published message in order, stops at the first slot a
+// producer has reserved but not filled yet
+static void drain()
+{
+	char batch[LAL_LOG_WRITE_BUFFER];
+	size_t batch_size = 0;
+
+	ullong64 dropped = atomic_exchange(&log_state.dropped, 0);
+	if(dropped > 0)
+	{
+		char message[64];
+		snprintf(message, sizeof(message), "%llu log messages dropped.", dropped);
+		emit(batch, &batch_size, LAL_LOG_WARN, message);
+	}
+
+	size_t position = atomic_load_explicit(&log_state.dequeue_position, memory_order_relaxed);
+	for(;;)
+	{
+		LogSlot *slot = &log_state.slots[position & (LAL_LOG_RING_SIZE - 1)];
+		if(atomic_load_explicit(&slot->sequence, memory_order_acquire) != position + 1)
+			break;
+
+		emit(batch, &batch_size, slot->level, slot->message);
+
+		atomic_store_explicit(&slot->sequence, position + LAL_LOG_RING_SIZE, memory_order_release);
+		position++;
+		atomic_store_explicit(&log_state.dequeue_position, position, memory_order_release);
+	}
+
+	if(batch_size > 0)
+		write_all(batch, batch_size);
+}
+
+static void *run_writer(void *arg)
+{
+	for(;;)
+	{
+		while(sem_wait(&log_state.pending) != 0)
+			;
+
+		drain();
+
+		if(atomic_load(&log_state.stop))
+			break;
+	}
+
+	drain();
+	return NULL;
+}
+
+// Returns FALSE if the writer could not be started
+static b8 ensure_writer()
+{
+	static b8 exit_handler_registered = FALSE;
+
+	sint32 expected = WRITER_STOPPED;
+	if(!atomic_compare_exchange_strong(&log_state.writer_state, &expected, WRITER_STARTING))
+		return TRUE;
+
+	atomic_store(&log_state.stop, 0);
+	if(pthread_create(&log_state.writer, NULL, run_writer, NULL) != 0)
+	{
+		atomic_store(&log_state.writer_state, WRITER_STOPPED);
+		return FALSE;
+	}
+
+	if(!exit_handler_registered)
+	{
+		atexit(lal_log_shutdown);
+		exit_handler_registered = TRUE;
+	}
+
+	atomic_store(&log_state.writer_state, WRITER_RUNNING);
+	return TRUE;
+}
+
+void lal_log(LalLogLevel level, const char *format, ...)
+{
+	if((uint32)level > atomic_load_explicit(&log_state.level, memory_order_relaxed))
+		return;
+
+	pthread_once(&ring_once, initialize_ring);
+
+	va_list args;
+	va_start(args, format);
+
+	if(!ensure_writer())
+	{
+		// No thread to hand the message to, write it here
+		char message[LAL_LOG_MESSAGE_SIZE];
+		vsnprintf(message, sizeof(message), format, args);
+		va_end(args);
+
+		fprintf(stderr, "%s%s\n", level_prefix(level), message);
+		return;
+	}
+
+	// Reserve a slot, multiple producers race on enqueue_position
+	LogSlot *slot;
+	size_t position = atomic_load_explicit(&log_state.enqueue_position, memory_order_relaxed);
+	for(;;)
+	{
+		slot = &log_state.slots[position & (LAL_LOG_RING_SIZE - 1)];
+		size_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+
+		if(sequence == position)
+		{
+			if(atomic_compare_exchange_weak_explicit(&log_state.enqueue_position, &position, position + 1,
+					memory_order_relaxed, memory_order_relaxed))
+				break;
+		}
+		else if(sequence < position)
+		{
+			// Ring is full, the writer reports the count
+			va_end(args);
+			atomic_fetch_add_explicit(&log_state.dropped, 1, memory_order_relaxed);
+			return;
+		}
+		else
+		{
+			position = atomic_load_explicit(&log_state.enqueue_position, memory_order_relaxed);
+		}
+	}
+
+	slot->level = (uint32)level;
+	vsnprintf(slot->message, sizeof(slot->message), format, args);
+	va_end(args);
+
+	atomic_store_explicit(&slot->sequence, position + 1, memory_order_release);
+
+	// Only enters the kernel when the writer is asleep
+	sem_post(&log_state.pending);
+}
+
+void lal_log_set_level(LalLogLevel level)
+{
+	atomic_store(&log_state.level, (uint32)level);
+}
+
+void lal_log_set_sink(LalLogSink sink, void *user_data)
+{
+	log_state.sink = sink;
+	log_state.sink_user_data = user_data;
+}
+
+void lal_log_flush()
+{
+	if(atomic_load(&log_state.writer_state) != WRITER_RUNNING)
+		return;
+
+	size_t target = atomic_load(&log_state.enqueue_position);
+	struct timespec delay = { 0, 1000000 };
+
+	while(atomic_load(&log_state.dequeue_position) < target)
+	{
+		sem_post(&log_state.pending);
+		nanosleep(&delay, NULL);
+	}
+}
+
+void lal_log_shutdown()
+{
+	if(atomic_load(&log_state.writer_state) != WRITER_RUNNING)
+		return;
+
+	lal_log_flush();
+
+	atomic_store(&log_state.stop, 1);
+	sem_post(&log_state.pending);
+	pthread_join(log_state.writer, NULL);
+
+	atomic_store(&log_state.writer_state, WRITER_STOPPED);
+}
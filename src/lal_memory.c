@@ -0,0 +1,228 @@
+#include "lal_defines.h"
+#include "lal_error_list.h"
+#include "lal/lal_memory.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+// Every arena allocation and pool block is aligned to this
+#define LAL_MEMORY_ALIGNMENT 16
+
+static void *default_allocate(void *user_data, size_t size)
+{
+	return malloc(size);
+}
+
+static void default_deallocate(void *user_data, void *ptr, size_t size)
+{
+	free(ptr);
+}
+
+static void *arena_allocate(void *user_data, size_t size);
+
+static LalAllocator allocator = { default_allocate, default_deallocate, NULL };
+static LalMemoryStats stats;
+
+// Share of the live stats held by the installed arena. Its blocks stay
+// live until lal_arena_reset, lal_free does not release them.
+static size_t arena_live_bytes;
+static ullong64 arena_live_allocations;
+
+static b8 arena_installed()
+{
+	return allocator.allocate == arena_allocate;
+}
+
+static size_t align_up(size_t value)
+{
+	return (value + (LAL_MEMORY_ALIGNMENT - 1)) & ~(size_t)(LAL_MEMORY_ALIGNMENT - 1);
+}
+
+void lal_memory_initialize(const LalAllocator *new_allocator)
+{
+	if(new_allocator == NULL)
+	{
+		allocator.allocate = default_allocate;
+		allocator.deallocate = default_deallocate;
+		allocator.user_data = NULL;
+	}
+	else
+	{
+		allocator = *new_allocator;
+	}
+
+	arena_live_bytes = 0;
+	arena_live_allocations = 0;
+}
+
+void *lal_allocate(size_t size)
+{
+	void *ptr = allocator.allocate(allocator.user_data, size);
+	if(ptr == NULL)
+		return NULL;
+
+	stats.live_bytes += size;
+	stats.allocation_count++;
+	stats.live_allocations++;
+	if(stats.live_bytes > stats.peak_bytes)
+		stats.peak_bytes = stats.live_bytes;
+
+	if(arena_installed())
+	{
+		arena_live_bytes += size;
+		arena_live_allocations++;
+	}
+
+	return ptr;
+}
+
+void lal_free(void *ptr, size_t size)
+{
+	if(ptr == NULL)
+		return;
+
+	allocator.deallocate(allocator.user_data, ptr, size);
+
+	if(arena_installed())
+		return;
+
+	stats.live_bytes -= size;
+	stats.live_allocations--;
+}
+
+LalMemoryStats lal_memory_stats()
+{
+	return stats;
+}
+
+void lal_memory_check_frame(LalFrameCheck *check, uint32 warmup_frames)
+{
+	if(check->frames >= warmup_frames)
+		assert(stats.allocation_count == check->allocation_count && "allocation in steady state frame");
+	else
+		check->frames++;
+
+	check->allocation_count = stats.allocation_count;
+}
+
+// Linear arena
+
+void lal_arena_create(LalArena *arena, void *memory, size_t capacity)
+{
+	arena->memory = (uchar8 *)memory;
+	arena->capacity = capacity;
+	arena->offset = 0;
+}
+
+void *lal_arena_allocate(LalArena *arena, size_t size)
+{
+	// Align the absolute address, the backing block may not be aligned
+	uintptr_t base = (uintptr_t)arena->memory;
+	size_t start = align_up(base + arena->offset) - base;
+
+	if(start + size > arena->capacity)
+		return NULL;
+
+	arena->offset = start + size;
+
+	return arena->memory + start;
+}
+
+void lal_arena_reset(LalArena *arena)
+{
+	arena->offset = 0;
+
+	if(arena_installed() && allocator.user_data == arena)
+	{
+		stats.live_bytes -= arena_live_bytes;
+		stats.live_allocations -= arena_live_allocations;
+		arena_live_bytes = 0;
+		arena_live_allocations = 0;
+	}
+}
+
+static void *arena_allocate(void *user_data, size_t size)
+{
+	return lal_arena_allocate((LalArena *)user_data, size);
+}
+
+static void arena_deallocate(void *user_data, void *ptr, size_t size)
+{
+	// Memory is only released by lal_arena_reset
+}
+
+LalAllocator lal_arena_allocator(LalArena *arena)
+{
+	LalAllocator arena_allocator = { arena_allocate, arena_deallocate, arena };
+	return arena_allocator;
+}
+
+// Fixed-size pool
+
+b8 lal_pool_create(LalPool *pool, void *memory, size_t block_size, size_t block_count)
+{
+	// Free blocks store the next pointer in place
+	block_size = align_up(block_size);
+
+	pool->memory = (uchar8 *)memory;
+	pool->block_size = block_size;
+	pool->block_count = block_count;
+	pool->used_blocks = 0;
+	pool->free_list = NULL;
+
+	if(memory == NULL || block_size == 0 || block_count == 0 || (uintptr_t)memory % LAL_MEMORY_ALIGNMENT != 0)
+		return FAILED;
+
+	// Thread blocks into the free list, first block on top
+	for(size_t i = block_count; i > 0; i--)
+	{
+		void **block = (void **)(pool->memory + (i - 1) * block_size);
+		*block = pool->free_list;
+		pool->free_list = block;
+	}
+
+	return OK;
+}
+
+void *lal_pool_allocate(LalPool *pool)
+{
+	void **block = (void **)pool->free_list;
+	if(block == NULL)
+		return NULL;
+
+	pool->free_list = *block;
+	pool->used_blocks++;
+
+	return block;
+}
+
+void lal_pool_free(LalPool *pool, void *ptr)
+{
+	if(ptr == NULL)
+		return;
+
+	*(void **)ptr = pool->free_list;
+	pool->free_list = ptr;
+	pool->used_blocks--;
+}
+
+static void *pool_allocate(void *user_data, size_t size)
+{
+	LalPool *pool = (LalPool *)user_data;
+	if(size > pool->block_size)
+		return NULL;
+
+	return lal_pool_allocate(pool);
+}
+
+static void pool_deallocate(void *user_data, void *ptr, size_t size)
+{
+	lal_pool_free((LalPool *)user_data, ptr);
+}
+
+LalAllocator lal_pool_allocator(LalPool *pool)
+{
+	LalAllocator pool_allocator = { pool_allocate, pool_deallocate, pool };
+	return pool_allocator;
+}
@@ -0,0 +1,492 @@
+// RandR monitor cache of the window backends, refreshed after RandR notifications
+
+#include "lal_defines.h"
+#include "lal_error_list.h"
+#include "lal/lal_monitor.h"
+#include "lal/lal_memory.h"
+#include "lal/lal_log.h"
+#include "lal_window_internal.h"
+
+#if LPLATFORM_LINUX
+
+#include <xcb/randr.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Only for XESetWireToEvent, without libXrandr Xlib drops RandR events
+#include <X11/Xlibint.h>
+
+#define DEFAULT_DPI 96.0f
+
+// RESOURCE_MANAGER is read up to this size, in 32 bit units
+#define RESOURCE_MANAGER_LENGTH 16384
+
+typedef struct MonitorState
+{
+    LalMonitorTable table;
+
+    // First RandR event code, -1 without RandR 1.5
+    sint32 randr_event_base;
+
+    // Table indices are the Xinerama screen numbers, see get_xinerama_index
+    b8 xinerama_order;
+
+    // Root window size from the last refresh. Without libXrandr nothing
+    // calls XRRUpdateConfiguration, DisplayWidth keeps the startup size.
+    uint32 root_width;
+    uint32 root_height;
+
+    // A RandR notification arrived, the table is requeried on the next
+    // read and LAL_EVENT_MONITORS_CHANGED is owed at the end of the batch
+    b8 dirty;
+    b8 changed;
+
+    // Window position in root coordinates, and the last parent relative
+    // position from a real ConfigureNotify
+    sint32 window_x;
+    sint32 window_y;
+    sint32 parent_x;
+    sint32 parent_y;
+} MonitorState;
+
+// Xlib only needs the type to hand the event out, the table is requeried
+static Bool randr_wire_to_event(Display *display, XEvent *event, xEvent *wire)
+{
+    event->xany.type = wire->u.u.type & 0x7F;
+    event->xany.serial = _XSetLastRequestRead(display, (xGenericReply *)wire);
+    event->xany.send_event = (wire->u.u.type & 0x80) != 0;
+    event->xany.display = display;
+    event->xany.window = None;
+    return True;
+}
+
+static f32 parse_xft_dpi(const char *resources, size_t size)
+{
+    const char *end = resources + size;
+    const char *line = resources;
+
+    while(line < end)
+    {
+        const char *next = memchr(line, '\n', (size_t)(end - line));
+        if(next == NULL)
+            next = end;
+
+        if(next - line > 8 && memcmp(line, "Xft.dpi:", 8) == 0)
+        {
+            char value[32];
+            size_t length = (size_t)(next - line - 8);
+            if(length >= sizeof(value))
+                length = sizeof(value) - 1;
+            memcpy(value, line + 8, length);
+            value[length] = '\0';
+
+            f32 dpi = strtof(value, NULL);
+            if(dpi > 0.0f)
+                return dpi;
+        }
+
+        line = next + 1;
+    }
+
+    return DEFAULT_DPI;
+}
+
+static f32 mode_refresh(const xcb_randr_get_screen_resources_current_reply_t *resources, xcb_randr_mode_t mode)
+{
+    xcb_randr_mode_info_t *modes = xcb_randr_get_screen_resources_current_modes(resources);
+    sint32 count = xcb_randr_get_screen_resources_current_modes_length(resources);
+
+    for(sint32 i = 0; i < count; i++)
+    {
+        if(modes[i].id != mode)
+            continue;
+
+        f32 vtotal = modes[i].vtotal;
+        if(modes[i].mode_flags & XCB_RANDR_MODE_FLAG_DOUBLE_SCAN)
+            vtotal *= 2.0f;
+        if(modes[i].mode_flags & XCB_RANDR_MODE_FLAG_INTERLACE)
+            vtotal /= 2.0f;
+
+        if(modes[i].htotal == 0 || vtotal == 0.0f)
+            return 0.0f;
+        return (f32)modes[i].dot_clock / ((f32)modes[i].htotal * vtotal);
+    }
+
+    return 0.0f;
+}
+
+static void set_physical_size(LalMonitor *monitor, uint32 width_mm, uint32 height_mm)
+{
+    monitor->width_mm = width_mm;
+    monitor->height_mm = height_mm;
+    monitor->dpi_x = width_mm > 0 ? (f32)monitor->width * 25.4f / (f32)width_mm : 0.0f;
+    monitor->dpi_y = height_mm > 0 ? (f32)monitor->height * 25.4f / (f32)height_mm : 0.0f;
+}
+
+// The screen as one monitor, for servers without RandR 1.5
+static void fill_screen_monitor(MonitorState *state, Display *display)
+{
+    LalMonitorTable *table = &state->table;
+    sint32 screen = DefaultScreen(display);
+    LalMonitor *monitor = &table->monitors[0];
+
+    memset(monitor, 0, sizeof(LalMonitor));
+    strncpy(monitor->name, "default", LAL_MONITOR_NAME_SIZE - 1);
+    monitor->width = state->root_width;
+    monitor->height = state->root_height;
+    monitor->primary = TRUE;
+    set_physical_size(monitor, (uint32)DisplayWidthMM(display, screen), (uint32)DisplayHeightMM(display, screen));
+    table->count = 1;
+}
+
+// Monitors, then the first output of each, then its CRTC. Requests of a
+// stage are pipelined, a refresh costs three round trips whatever the count.
+static void fill_randr_monitors(LalMonitorTable *table, xcb_connection_t *connection,
+        const xcb_randr_get_monitors_reply_t *monitors, const xcb_randr_get_screen_resources_current_reply_t *resources)
+{
+    xcb_get_atom_name_cookie_t name_cookies[LAL_MAX_MONITORS];
+    xcb_randr_get_output_info_cookie_t output_cookies[LAL_MAX_MONITORS];
+    xcb_randr_get_crtc_info_cookie_t crtc_cookies[LAL_MAX_MONITORS];
+    b8 has_output[LAL_MAX_MONITORS];
+    b8 has_crtc[LAL_MAX_MONITORS];
+
+    table->count = 0;
+    for(xcb_randr_monitor_info_iterator_t it = xcb_randr_get_monitors_monitors_iterator(monitors);
+            it.rem > 0 && table->count < LAL_MAX_MONITORS; xcb_randr_monitor_info_next(&it))
+    {
+        uint32 i = table->count++;
+        LalMonitor *monitor = &table->monitors[i];
+
+        memset(monitor, 0, sizeof(LalMonitor));
+        monitor->x = it.data->x;
+        monitor->y = it.data->y;
+        monitor->width = it.data->width;
+        monitor->height = it.data->height;
+        monitor->primary = it.data->primary != 0;
+        set_physical_size(monitor, it.data->width_in_millimeters, it.data->height_in_millimeters);
+
+        name_cookies[i] = xcb_get_atom_name(connection, it.data->name);
+        has_output[i] = xcb_randr_monitor_info_outputs_length(it.data) > 0 && resources != NULL;
+        if(has_output[i])
+            output_cookies[i] = xcb_randr_get_output_info(connection, xcb_randr_monitor_info_outputs(it.data)[0],
+                resources->config_timestamp);
+    }
+
+    for(uint32 i = 0; i < table->count; i++)
+    {
+        xcb_get_atom_name_reply_t *name = xcb_get_atom_name_reply(connection, name_cookies[i], NULL);
+        if(name != NULL)
+        {
+            size_t length = (size_t)xcb_get_atom_name_name_length(name);
+            if(length >= LAL_MONITOR_NAME_SIZE)
+                length = LAL_MONITOR_NAME_SIZE - 1;
+            memcpy(table->monitors[i].name, xcb_get_atom_name_name(name), length);
+            free(name);
+        }
+
+        has_crtc[i] = FALSE;
+        if(!has_output[i])
+            continue;
+
+        xcb_randr_get_output_info_reply_t *output = xcb_randr_get_output_info_reply(connection, output_cookies[i], NULL);
+        if(output != NULL && output->crtc != XCB_NONE)
+        {
+            crtc_cookies[i] = xcb_randr_get_crtc_info(connection, output->crtc, resources->config_timestamp);
+            has_crtc[i] = TRUE;
+        }
+        free(output);
+    }
+
+    for(uint32 i = 0; i < table->count; i++)
+    {
+        if(!has_crtc[i])
+            continue;
+
+        xcb_randr_get_crtc_info_reply_t *crtc = xcb_randr_get_crtc_info_reply(connection, crtc_cookies[i], NULL);
+        if(crtc != NULL && crtc->mode != XCB_NONE)
+            table->monitors[i].refresh_hz = mode_refresh(resources, crtc->mode);
+        free(crtc);
+    }
+}
+
+// The server emulates Xinerama from the same active monitor list, in the
+// same order. Under real Xinerama RandR only sees the first X screen, its
+// monitors don't span the combined root.
+static b8 covers_screen(const MonitorState *state)
+{
+    const LalMonitorTable *table = &state->table;
+    sint32 right = 0;
+    sint32 bottom = 0;
+
+    for(uint32 i = 0; i < table->count; i++)
+    {
+        const LalMonitor *monitor = &table->monitors[i];
+        if(monitor->x + (sint32)monitor->width > right)
+            right = monitor->x + (sint32)monitor->width;
+        if(monitor->y + (sint32)monitor->height > bottom)
+            bottom = monitor->y + (sint32)monitor->height;
+    }
+
+    return table->count > 0 && (uint32)right == state->root_width && (uint32)bottom == state->root_height;
+}
+
+static void refresh_monitors(MonitorState *state, Display *display)
+{
+    xcb_connection_t *connection = XGetXCBConnection(display);
+    xcb_window_t root = (xcb_window_t)DefaultRootWindow(display);
+    xcb_randr_get_monitors_cookie_t monitors_cookie;
+    xcb_randr_get_screen_resources_current_cookie_t resources_cookie;
+
+    if(state->randr_event_base >= 0)
+    {
+        monitors_cookie = xcb_randr_get_monitors(connection, root, 1);
+        resources_cookie = xcb_randr_get_screen_resources_current(connection, root);
+    }
+
+    xcb_get_property_cookie_t resources_property = xcb_get_property(connection, 0, root,
+        XCB_ATOM_RESOURCE_MANAGER, XCB_ATOM_STRING, 0, RESOURCE_MANAGER_LENGTH);
+    xcb_get_geometry_cookie_t geometry_cookie = xcb_get_geometry(connection, root);
+
+    xcb_get_geometry_reply_t *geometry = xcb_get_geometry_reply(connection, geometry_cookie, NULL);
+    if(geometry != NULL)
+    {
+        state->root_width = geometry->width;
+        state->root_height = geometry->height;
+        free(geometry);
+    }
+
+    if(state->randr_event_base >= 0)
+    {
+        xcb_randr_get_monitors_reply_t *monitors = xcb_randr_get_monitors_reply(connection, monitors_cookie, NULL);
+        xcb_randr_get_screen_resources_current_reply_t *resources =
+            xcb_randr_get_screen_resources_current_reply(connection, resources_cookie, NULL);
+
+        state->xinerama_order = FALSE;
+        if(monitors != NULL)
+        {
+            fill_randr_monitors(&state->table, connection, monitors, resources);
+            state->xinerama_order = covers_screen(state);
+        }
+        else
+        {
+            fill_screen_monitor(state, display);
+        }
+
+        free(monitors);
+        free(resources);
+    }
+    else
+    {
+        state->xinerama_order = FALSE;
+        fill_screen_monitor(state, display);
+    }
+
+    state->table.xft_dpi = DEFAULT_DPI;
+    xcb_get_property_reply_t *property = xcb_get_property_reply(connection, resources_property, NULL);
+    if(property != NULL)
+    {
+        state->table.xft_dpi = parse_xft_dpi((const char *)xcb_get_property_value(property),
+            (size_t)xcb_get_property_value_length(property));
+        free(property);
+    }
+
+    state->table.generation++;
+}
+
+static sint32 find_window_monitor(PlatformHandler *platform_handler, MonitorState *state)
+{
+    sint32 center_x = state->window_x + (sint32)(platform_handler->width / 2);
+    sint32 center_y = state->window_y + (sint32)(platform_handler->height / 2);
+
+    for(uint32 i = 0; i < state->table.count; i++)
+    {
+        const LalMonitor *monitor = &state->table.monitors[i];
+        if(center_x >= monitor->x && center_x < monitor->x + (sint32)monitor->width
+                && center_y >= monitor->y && center_y < monitor->y + (sint32)monitor->height)
+            return (sint32)i;
+    }
+
+    return -1;
+}
+
+static void query_window_position(MonitorState *state, Display *display, ulong32 window)
+{
+    Window child;
+    sint32 x = 0;
+    sint32 y = 0;
+
+    if(XTranslateCoordinates(display, window, DefaultRootWindow(display), 0, 0, &x, &y, &child))
+    {
+        state->window_x = x;
+        state->window_y = y;
+    }
+}
+
+void initialize_monitors(PlatformHandler *platform_handler)
+{
+    ulong32 window;
+    Display *display = get_x_window(platform_handler, &window);
+    xcb_connection_t *connection = XGetXCBConnection(display);
+
+    MonitorState *state = lal_allocate(sizeof(MonitorState));
+    if(state == NULL)
+        return;
+
+    memset(state, 0, sizeof(MonitorState));
+    state->randr_event_base = -1;
+    state->root_width = (uint32)DisplayWidth(display, DefaultScreen(display));
+    state->root_height = (uint32)DisplayHeight(display, DefaultScreen(display));
+
+    // Monitors are RandR 1.5, older servers fall back to the screen size
+    const xcb_query_extension_reply_t *extension = xcb_get_extension_data(connection, &xcb_randr_id);
+    if(extension != NULL && extension->present)
+    {
+        xcb_randr_query_version_reply_t *version = xcb_randr_query_version_reply(connection,
+            xcb_randr_query_version(connection, 1, 5), NULL);
+
+        if(version != NULL && (version->major_version > 1 || version->minor_version >= 5))
+        {
+            state->randr_event_base = extension->first_event;
+
+            XESetWireToEvent(display, extension->first_event + XCB_RANDR_SCREEN_CHANGE_NOTIFY, randr_wire_to_event);
+            XESetWireToEvent(display, extension->first_event + XCB_RANDR_NOTIFY, randr_wire_to_event);
+
+            xcb_randr_select_input(connection, (xcb_window_t)DefaultRootWindow(display),
+                XCB_RANDR_NOTIFY_MASK_SCREEN_CHANGE | XCB_RANDR_NOTIFY_MASK_CRTC_CHANGE
+                | XCB_RANDR_NOTIFY_MASK_OUTPUT_CHANGE);
+        }
+        free(version);
+    }
+
+    if(state->randr_event_base < 0)
+        LAL_INFO("RandR 1.5 is not available, reporting the screen as one monitor.");
+
+    refresh_monitors(state, display);
+    query_window_position(state, display, window);
+
+    platform_handler->monitors = state;
+}
+
+void destroy_monitors(PlatformHandler *platform_handler)
+{
+    if(platform_handler->monitors == NULL)
+        return;
+
+    lal_free(platform_handler->monitors, sizeof(MonitorState));
+    platform_handler->monitors = NULL;
+}
+
+void track_window_position(PlatformHandler *platform_handler, sint32 x, sint32 y, b8 synthetic)
+{
+    ulong32 window;
+    MonitorState *state = (MonitorState *)platform_handler->monitors;
+    if(state == NULL)
+        return;
+
+    // Window managers send synthetic ConfigureNotify in root coordinates
+    if(synthetic)
+    {
+        state->window_x = x;
+        state->window_y = y;
+        return;
+    }
+
+    // Real ones are relative to the parent, a reparented window only sees
+    // them change on resizes of the frame. Resolve those moves once.
+    if(x == state->parent_x && y == state->parent_y)
+        return;
+
+    Display *display = get_x_window(platform_handler, &window);
+    state->parent_x = x;
+    state->parent_y = y;
+    query_window_position(state, display, window);
+}
+
+// One mode change sends a burst of RRNotify, a refresh per event would
+// cost three round trips each
+void handle_monitor_event(PlatformHandler *platform_handler, uint32 type)
+{
+    MonitorState *state = (MonitorState *)platform_handler->monitors;
+
+    if(state == NULL || state->randr_event_base < 0
+            || (type != (uint32)state->randr_event_base + XCB_RANDR_SCREEN_CHANGE_NOTIFY
+                && type != (uint32)state->randr_event_base + XCB_RANDR_NOTIFY))
+        return;
+
+    state->dirty = TRUE;
+    state->changed = TRUE;
+}
+
+static MonitorState *get_monitor_state(PlatformHandler *platform_handler)
+{
+    ulong32 window;
+    MonitorState *state = (MonitorState *)platform_handler->monitors;
+
+    if(state != NULL && state->dirty)
+    {
+        refresh_monitors(state, get_x_window(platform_handler, &window));
+        state->dirty = FALSE;
+    }
+
+    return state;
+}
+
+b8 flush_monitor_event(PlatformHandler *platform_handler, LalEvent *out)
+{
+    MonitorState *state = (MonitorState *)platform_handler->monitors;
+
+    if(state == NULL || !state->changed)
+        return FALSE;
+
+    get_monitor_state(platform_handler);
+    state->changed = FALSE;
+
+    out->type = LAL_EVENT_MONITORS_CHANGED;
+    out->time = platform_handler->last_server_time;
+    out->monitors.generation = state->table.generation;
+    out->monitors.window_monitor = find_window_monitor(platform_handler, state);
+    return TRUE;
+}
+
+const LalMonitorTable *lal_get_monitors(PlatformHandler *platform_handler)
+{
+    static const LalMonitorTable empty_table = { .xft_dpi = DEFAULT_DPI };
+    MonitorState *state = get_monitor_state(platform_handler);
+
+    return state != NULL ? &state->table : &empty_table;
+}
+
+sint32 lal_get_window_monitor(PlatformHandler *platform_handler)
+{
+    MonitorState *state = get_monitor_state(platform_handler);
+    return state != NULL ? find_window_monitor(platform_handler, state) : -1;
+}
+
+void get_root_size(PlatformHandler *platform_handler, uint32 *width, uint32 *height)
+{
+    ulong32 window;
+    MonitorState *state = get_monitor_state(platform_handler);
+
+    if(state != NULL)
+    {
+        *width = state->root_width;
+        *height = state->root_height;
+        return;
+    }
+
+    Display *display = get_x_window(platform_handler, &window);
+    *width = (uint32)DisplayWidth(display, DefaultScreen(display));
+    *height = (uint32)DisplayHeight(display, DefaultScreen(display));
+}
+
+sint32 get_xinerama_index(PlatformHandler *platform_handler, sint32 monitor)
+{
+    MonitorState *state = get_monitor_state(platform_handler);
+
+    if(state == NULL || !state->xinerama_order || monitor < 0 || (uint32)monitor >= state->table.count)
+        return -1;
+
+    return monitor;
+}
+
+#endif // LPLATFORM_LINUX
@@ -0,0 +1,482 @@
+#include "lal_defines.h"
+#include "lal_error_list.h"
+#include "lal/lal_raw_keyboard.h"
+#include "lal/lal_log.h"
+#include "lal_window_internal.h"
+#include "lal_evdev.h"
+
+#if LPLATFORM_LINUX
+
+// evdev code and Keys value, both without their KEY_ prefix
+#define RAW_KEYMAP(KEY) \
+	KEY(ESC, ESCAPE) KEY(1, 1) KEY(2, 2) KEY(3, 3) KEY(4, 4) KEY(5, 5) KEY(6, 6) KEY(7, 7) KEY(8, 8) KEY(9, 9) KEY(0, 0) \
+	KEY(MINUS, MINUS) KEY(EQUAL, EQUAL) KEY(BACKSPACE, BACKSPACE) KEY(TAB, TAB) \
+	KEY(Q, Q) KEY(W, W) KEY(E, E) KEY(R, R) KEY(T, T) KEY(Y, Y) KEY(U, U) KEY(I, I) KEY(O, O) KEY(P, P) \
+	KEY(LEFTBRACE, LBRACKET) KEY(RIGHTBRACE, RBRACKET) KEY(ENTER, ENTER) KEY(LEFTCTRL, LCONTROL) \
+	KEY(A, A) KEY(S, S) KEY(D, D) KEY(F, F) KEY(G, G) KEY(H, H) KEY(J, J) KEY(K, K) KEY(L, L) \
+	KEY(SEMICOLON, SEMICOLON) KEY(APOSTROPHE, APOSTROPHE) KEY(GRAVE, GRAVE) KEY(LEFTSHIFT, LSHIFT) \
+	KEY(BACKSLASH, BACKSLASH) KEY(Z, Z) KEY(X, X) KEY(C, C) KEY(V, V) KEY(B, B) KEY(N, N) KEY(M, M) \
+	KEY(COMMA, COMMA) KEY(DOT, PERIOD) KEY(SLASH, SLASH) KEY(RIGHTSHIFT, RSHIFT) \
+	KEY(LEFTALT, LALT) KEY(SPACE, SPACE) KEY(CAPSLOCK, CAPITAL) KEY(RIGHTCTRL, RCONTROL) KEY(RIGHTALT, RALT) \
+	KEY(LEFTMETA, LSUPER) KEY(RIGHTMETA, RSUPER) KEY(COMPOSE, APPS) \
+	KEY(F1, F1) KEY(F2, F2) KEY(F3, F3) KEY(F4, F4) KEY(F5, F5) KEY(F6, F6) KEY(F7, F7) KEY(F8, F8) \
+	KEY(F9, F9) KEY(F10, F10) KEY(F11, F11) KEY(F12, F12) KEY(F13, F13) KEY(F14, F14) KEY(F15, F15) KEY(F16, F16) \
+	KEY(F17, F17) KEY(F18, F18) KEY(F19, F19) KEY(F20, F20) KEY(F21, F21) KEY(F22, F22) KEY(F23, F23) KEY(F24, F24) \
+	KEY(NUMLOCK, NUMLOCK) KEY(SCROLLLOCK, SCROLL) \
+	KEY(KP0, NUMPAD0) KEY(KP1, NUMPAD1) KEY(KP2, NUMPAD2) KEY(KP3, NUMPAD3) KEY(KP4, NUMPAD4) \
+	KEY(KP5, NUMPAD5) KEY(KP6, NUMPAD6) KEY(KP7, NUMPAD7) KEY(KP8, NUMPAD8) KEY(KP9, NUMPAD9) \
+	KEY(KPASTERISK, MULTIPLY) KEY(KPMINUS, SUBTRACT) KEY(KPPLUS, ADD) KEY(KPDOT, DECIMAL) \
+	KEY(KPSLASH, DIVIDE) KEY(KPENTER, ENTER) KEY(KPEQUAL, NUMPAD_EQUAL) KEY(KPCOMMA, SEPARATOR) \
+	KEY(HOME, HOME) KEY(UP, UP) KEY(PAGEUP, PAGEUP) KEY(LEFT, LEFT) KEY(RIGHT, RIGHT) KEY(END, END) \
+	KEY(DOWN, DOWN) KEY(PAGEDOWN, PAGEDOWN) KEY(INSERT, INSERT) KEY(DELETE, DELETE) \
+	KEY(SYSRQ, PRINTSCREEN) KEY(PRINT, PRINT) KEY(PAUSE, PAUSE) KEY(HELP, HELP) KEY(SELECT, SELECT) \
+	KEY(SLEEP, SLEEP) KEY(HENKAN, CONVERT) KEY(MUHENKAN, NONCONVERT)
+
+// linux/input.h redefines the KEY_* names of Keys as evdev codes. Capture the
+// Keys values under the evdev name before including it, build the table after.
+#define CAPTURE_KEY(evdev, lal) LAL_RAW_##evdev = KEY_##lal,
+enum { RAW_KEYMAP(CAPTURE_KEY) };
+
+#include <linux/input.h>
+
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// evdev code to Keys, 0 for codes Keys has no value for
+#define MAP_KEY(evdev, lal) [KEY_##evdev] = LAL_RAW_##evdev,
+static const uchar8 keymap[KEY_CNT] = { RAW_KEYMAP(MAP_KEY) };
+
+// Keys read but not polled yet, must be a power of two
+#define LAL_RAW_KEY_QUEUE 256
+
+// epoll tag of the inotify descriptor, keyboards use their index
+#define HOTPLUG_TAG LAL_MAX_RAW_KEYBOARDS
+
+// input_events read per read(2)
+#define LAL_RAW_KEYBOARD_EVENT_BATCH 64
+
+typedef struct RawKey
+{
+	uint32 time;
+	ushort16 code;
+	uchar8 keyboard;
+	// 0 release, 1 press, 2 autorepeat
+	uchar8 value;
+} RawKey;
+
+typedef struct KeyboardDevice
+{
+	sint32 fd;
+
+	// Set by SYN_DROPPED, the keys are reread at the next SYN_REPORT
+	b8 dropped;
+
+	// Codes whose press was delivered, released on focus loss and unplug
+	ulong32 down[BIT_WORDS(KEY_CNT)];
+
+	char path[LAL_EVDEV_PATH_SIZE];
+} KeyboardDevice;
+
+static KeyboardDevice devices[LAL_MAX_RAW_KEYBOARDS];
+static RawKey queue[LAL_RAW_KEY_QUEUE];
+static uint32 queue_head;
+static uint32 queue_count;
+static ullong64 queue_dropped;
+
+static PlatformHandler *raw_platform_handler;
+static uint32 raw_flags;
+static sint32 epoll_fd = -1;
+static sint32 inotify_fd = -1;
+
+static void set_down(KeyboardDevice *device, uint32 code, b8 down)
+{
+	if(down)
+		device->down[code / BITS_PER_LONG] |= 1ul << (code % BITS_PER_LONG);
+	else
+		device->down[code / BITS_PER_LONG] &= ~(1ul << (code % BITS_PER_LONG));
+}
+
+// Same clock as the X server timestamps, see EVIOCSCLOCKID in open_keyboard
+static uint32 event_time(const struct input_event *event)
+{
+	return (uint32)((ullong64)event->input_event_sec * 1000 + (ullong64)event->input_event_usec / 1000);
+}
+
+static uint32 current_time()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint32)((ullong64)now.tv_sec * 1000 + (ullong64)now.tv_nsec / 1000000);
+}
+
+static void queue_key(uint32 keyboard, uint32 code, sint32 value, uint32 time)
+{
+	if(code >= KEY_CNT || keymap[code] == 0)
+		return;
+
+	if(queue_count == LAL_RAW_KEY_QUEUE)
+	{
+		queue_dropped++;
+		return;
+	}
+
+	RawKey *key = &queue[(queue_head + queue_count) & (LAL_RAW_KEY_QUEUE - 1)];
+	key->time = time;
+	key->code = (ushort16)code;
+	key->keyboard = (uchar8)keyboard;
+	key->value = (uchar8)(value > 2 ? 2 : value);
+	queue_count++;
+}
+
+// Queues the difference between the delivered keys and the device state
+static void resync(uint32 keyboard)
+{
+	KeyboardDevice *device = &devices[keyboard];
+	ulong32 keys[BIT_WORDS(KEY_CNT)] = { 0 };
+
+	if(ioctl(device->fd, EVIOCGKEY(sizeof(keys)), keys) < 0)
+		return;
+
+	uint32 time = current_time();
+	for(uint32 code = 0; code < KEY_CNT; code++)
+	{
+		if(TEST_BIT(keys, code) != TEST_BIT(device->down, code))
+			queue_key(keyboard, code, (sint32)TEST_BIT(keys, code), time);
+	}
+}
+
+static void close_keyboard(uint32 keyboard)
+{
+	KeyboardDevice *device = &devices[keyboard];
+
+	epoll_ctl(epoll_fd, EPOLL_CTL_DEL, device->fd, NULL);
+	close(device->fd);
+
+	LAL_INFO("Raw keyboard %u disconnected: %s", keyboard, device->path);
+
+	// The down bits stay until the next poll delivers their releases
+	device->fd = -1;
+	device->path[0] = '\0';
+}
+
+static b8 has_down_keys(const KeyboardDevice *device)
+{
+	for(uint32 i = 0; i < BIT_WORDS(KEY_CNT); i++)
+	{
+		if(device->down[i] != 0)
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+// require_keyboard skips devices without letter keys, like power buttons
+static sint32 open_keyboard(const char *path, b8 require_keyboard)
+{
+	sint32 keyboard = -1;
+	for(uint32 i = 0; i < LAL_MAX_RAW_KEYBOARDS; i++)
+	{
+		if(devices[i].fd >= 0 && strcmp(devices[i].path, path) == 0)
+			return (sint32)i;
+		if(devices[i].fd < 0 && !has_down_keys(&devices[i]) && keyboard < 0)
+			keyboard = (sint32)i;
+	}
+
+	if(keyboard < 0)
+		return -1;
+
+	sint32 fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+	if(fd < 0)
+		return -1;
+
+	ulong32 key_bits[BIT_WORDS(KEY_CNT)] = { 0 };
+	b8 is_evdev = ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(key_bits)), key_bits) >= 0;
+	b8 is_keyboard = is_evdev && TEST_BIT(key_bits, KEY_A) && TEST_BIT(key_bits, KEY_SPACE);
+
+	if(require_keyboard && !is_keyboard)
+	{
+		close(fd);
+		return -1;
+	}
+
+	if(is_evdev)
+	{
+		// Timestamps default to CLOCK_REALTIME, X uses the monotonic clock
+		sint32 clock = CLOCK_MONOTONIC;
+		ioctl(fd, EVIOCSCLOCKID, &clock);
+
+		if((raw_flags & LAL_RAW_KEYBOARD_GRAB) && ioctl(fd, EVIOCGRAB, 1) < 0)
+			LAL_WARN("Could not grab %s, another client holds it.", path);
+	}
+
+	KeyboardDevice *device = &devices[keyboard];
+	memset(device, 0, sizeof(KeyboardDevice));
+	device->fd = fd;
+	snprintf(device->path, sizeof(device->path), "%s", path);
+
+	struct epoll_event event;
+	event.events = EPOLLIN;
+	event.data.u32 = (uint32)keyboard;
+	if(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0)
+	{
+		close(fd);
+		device->fd = -1;
+		return -1;
+	}
+
+	// Keys already held when the device is opened count as pressed now
+	if(is_evdev)
+		resync((uint32)keyboard);
+
+	char name[64] = "unknown";
+	if(is_evdev)
+		ioctl(fd, EVIOCGNAME(sizeof(name)), name);
+
+	LAL_INFO("Raw keyboard %d connected: %s (%s)", keyboard, name, path);
+
+	return keyboard;
+}
+
+static void open_new_keyboard(const char *path)
+{
+	open_keyboard(path, TRUE);
+}
+
+static void read_keyboard(uint32 keyboard)
+{
+	KeyboardDevice *device = &devices[keyboard];
+	struct input_event events[LAL_RAW_KEYBOARD_EVENT_BATCH];
+
+	for(;;)
+	{
+		ssize_t size = read(device->fd, events, sizeof(events));
+		if(size < 0 && errno == EINTR)
+			continue;
+		if(size < 0 && errno == EAGAIN)
+			return;
+
+		// ENODEV once unplugged, end of file for recorded streams
+		if(size <= 0)
+		{
+			close_keyboard(keyboard);
+			return;
+		}
+
+		size_t count = (size_t)size / sizeof(struct input_event);
+		for(size_t i = 0; i < count; i++)
+		{
+			struct input_event *event = &events[i];
+
+			if(event->type == EV_SYN && event->code == SYN_DROPPED)
+			{
+				device->dropped = TRUE;
+			}
+			else if(event->type == EV_SYN && event->code == SYN_REPORT && device->dropped)
+			{
+				device->dropped = FALSE;
+				resync(keyboard);
+			}
+			else if(event->type == EV_KEY && !device->dropped)
+			{
+				queue_key(keyboard, event->code, event->value, event_time(event));
+			}
+		}
+	}
+}
+
+static void dispatch_raw_keyboards(void *user_data)
+{
+	struct epoll_event ready[LAL_MAX_RAW_KEYBOARDS + 1];
+
+	sint32 count = epoll_wait(epoll_fd, ready, LAL_MAX_RAW_KEYBOARDS + 1, 0);
+	for(sint32 i = 0; i < count; i++)
+	{
+		if(ready[i].data.u32 == HOTPLUG_TAG)
+			evdev_read_hotplug(inotify_fd, open_new_keyboard);
+		else if(devices[ready[i].data.u32].fd >= 0)
+			read_keyboard(ready[i].data.u32);
+	}
+
+	if(queue_dropped > 0)
+	{
+		LAL_WARN("%llu raw key events dropped, the event poll is not keeping up.", queue_dropped);
+		queue_dropped = 0;
+	}
+}
+
+static b8 emit_key(PlatformHandler *platform_handler, uint32 code, b8 pressed, uint32 time, LalEvent *out)
+{
+	if(!translate_key(platform_handler, (Keys)keymap[code], pressed, time, out))
+		return FALSE;
+
+	dispatch_event(platform_handler, out);
+	return is_event_delivered(platform_handler, out);
+}
+
+// Releases the delivered keys of one keyboard, returns FALSE when out of room
+static b8 release_keys(PlatformHandler *platform_handler, KeyboardDevice *device,
+	LalEvent *events, uint32 capacity, uint32 *count)
+{
+	uint32 time = current_time();
+
+	for(uint32 code = 0; code < KEY_CNT; code++)
+	{
+		if(!TEST_BIT(device->down, code))
+			continue;
+
+		if(*count == capacity)
+			return FALSE;
+
+		set_down(device, code, FALSE);
+		if(emit_key(platform_handler, code, FALSE, time, &events[*count]))
+			(*count)++;
+	}
+
+	return TRUE;
+}
+
+uint32 poll_raw_keyboard_events(PlatformHandler *platform_handler, LalEvent *events, uint32 capacity)
+{
+	uint32 count = 0;
+
+	if(!platform_handler->raw_keyboard)
+		return 0;
+
+	b8 gate_open = (raw_flags & LAL_RAW_KEYBOARD_IGNORE_FOCUS) || platform_handler->focused;
+
+	for(uint32 i = 0; i < LAL_MAX_RAW_KEYBOARDS; i++)
+	{
+		if((!gate_open || devices[i].fd < 0) && has_down_keys(&devices[i])
+				&& !release_keys(platform_handler, &devices[i], events, capacity, &count))
+			return count;
+	}
+
+	while(queue_count > 0 && count < capacity)
+	{
+		RawKey *key = &queue[queue_head];
+		queue_head = (queue_head + 1) & (LAL_RAW_KEY_QUEUE - 1);
+		queue_count--;
+
+		KeyboardDevice *device = &devices[key->keyboard];
+		b8 down = TEST_BIT(device->down, key->code);
+
+		// Releases of presses that were never delivered are dropped too
+		if(key->value == 0 ? !down : (!gate_open || device->fd < 0))
+			continue;
+
+		set_down(device, key->code, key->value != 0);
+		if(emit_key(platform_handler, key->code, key->value != 0, key->time, &events[count]))
+			count++;
+	}
+
+	return count;
+}
+
+b8 lal_raw_keyboard_initialize(PlatformHandler *platform_handler, uint32 flags)
+{
+	if(epoll_fd >= 0)
+		return OK;
+
+	for(uint32 i = 0; i < LAL_MAX_RAW_KEYBOARDS; i++)
+	{
+		memset(&devices[i], 0, sizeof(KeyboardDevice));
+		devices[i].fd = -1;
+	}
+
+	queue_head = 0;
+	queue_count = 0;
+	queue_dropped = 0;
+	raw_platform_handler = platform_handler;
+	raw_flags = flags;
+
+	epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if(epoll_fd < 0)
+	{
+		LAL_ERROR("Failed to create raw keyboard epoll descriptor.");
+		return FAILED;
+	}
+
+	inotify_fd = evdev_watch_devices();
+	if(inotify_fd >= 0)
+	{
+		struct epoll_event event;
+		event.events = EPOLLIN;
+		event.data.u32 = HOTPLUG_TAG;
+		epoll_ctl(epoll_fd, EPOLL_CTL_ADD, inotify_fd, &event);
+	}
+	else
+	{
+		LAL_WARN("Raw keyboard hotplug is not available.");
+	}
+
+	evdev_scan_devices(open_new_keyboard);
+
+	if(lal_raw_keyboard_count() == 0)
+		LAL_WARN("No readable keyboard in %s, check the permissions of the event nodes.", LAL_EVDEV_DIRECTORY);
+
+	platform_handler->raw_keyboard = TRUE;
+
+	return add_wait_source(epoll_fd, dispatch_raw_keyboards, NULL);
+}
+
+void lal_raw_keyboard_shutdown()
+{
+	if(epoll_fd < 0)
+		return;
+
+	remove_wait_source(epoll_fd);
+
+	for(uint32 i = 0; i < LAL_MAX_RAW_KEYBOARDS; i++)
+	{
+		// Closing the descriptor also ends the grab
+		if(devices[i].fd >= 0)
+			close_keyboard(i);
+
+		// Nobody polls anymore, release straight into the input state
+		for(uint32 code = 0; code < KEY_CNT; code++)
+		{
+			if(TEST_BIT(devices[i].down, code))
+				input_process_key((Keys)keymap[code], FALSE);
+		}
+		memset(devices[i].down, 0, sizeof(devices[i].down));
+	}
+
+	if(inotify_fd >= 0)
+		close(inotify_fd);
+	close(epoll_fd);
+
+	inotify_fd = -1;
+	epoll_fd = -1;
+	queue_count = 0;
+
+	raw_platform_handler->raw_keyboard = FALSE;
+	raw_platform_handler = NULL;
+}
+
+sint32 lal_raw_keyboard_open(const char *path)
+{
+	if(epoll_fd < 0)
+		return -1;
+
+	return open_keyboard(path, FALSE);
+}
+
+uint32 lal_raw_keyboard_count()
+{
+	uint32 count = 0;
+	for(uint32 i = 0; i < LAL_MAX_RAW_KEYBOARDS; i++)
+	{
+		if(devices[i].fd >= 0)
+			count++;
+	}
+
+	return count;
+}
+
+#endif // LPLATFORM_LINUX
@@ -0,0 +1,386 @@
+#include "lal_defines.h"
+#include "lal_error_list.h"
+#include "lal/lal_recorder.h"
+#include "lal/lal_log.h"
+
+#if LPLATFORM_LINUX
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define RECORD_PAGE_SIZE 4096ull
+#define RECORD_ALIGN(size) (((size) + RECORD_PAGE_SIZE - 1) & ~(RECORD_PAGE_SIZE - 1))
+
+#define Y4M_STREAM_HEADER "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 C444\n"
+
+// "FRAME Xidx=<20 digits> Xpts=<20 digits>\n", fixed so slots stay equal
+#define Y4M_FRAME_HEADER_SIZE 58
+
+typedef struct RecorderState
+{
+	LalRecorderConfig config;
+	sint32 fd;
+	uchar8 *map;
+	size_t map_size;
+	ullong64 data_offset;
+	ullong64 slot_size;
+
+	// Frames committed by the capture thread and flushed by the writer.
+	// Slot k % slot_count is free for frame k once k - flushed < slot_count.
+	atomic_ullong committed;
+	atomic_ullong flushed;
+	atomic_ullong dropped;
+
+	// Slot the capture thread is filling and slot the writer is flushing,
+	// -1 when idle. Each side publishes its own before reading the other,
+	// so a slot is never overwritten while msync holds it.
+	atomic_llong writing_slot;
+	atomic_llong flushing_slot;
+
+	atomic_int stop;
+	sem_t pending;
+	pthread_t writer;
+
+	// lal_recorder_write calls in progress, the mapping outlives them
+	atomic_int running;
+	atomic_uint writers;
+} RecorderState;
+
+static RecorderState recorder;
+
+static void flush_range(ullong64 offset, ullong64 size)
+{
+	ullong64 start = offset & ~(RECORD_PAGE_SIZE - 1);
+	if(msync(recorder.map + start, (size_t)(offset + size - start), MS_SYNC) != 0)
+		LAL_WARN("Failed to flush recording.");
+}
+
+// Writes frames [first, last) back to the file, one slot at a time. A slot
+// the capture thread is refilling, only with LAL_RECORD_DROP_OLDEST, lost
+// its frame already and is left to the next flush.
+static void flush_frames(ullong64 first, ullong64 last)
+{
+	ullong64 slot_count = recorder.config.slot_count;
+
+	for(ullong64 frame = first; frame < last; frame++)
+	{
+		sllong64 slot = (sllong64)(frame % slot_count);
+
+		atomic_store(&recorder.flushing_slot, slot);
+		if(atomic_load(&recorder.writing_slot) == slot)
+			atomic_fetch_add(&recorder.dropped, 1);
+		else
+			flush_range(recorder.data_offset + (ullong64)slot * recorder.slot_size, recorder.slot_size);
+	}
+
+	atomic_store(&recorder.flushing_slot, -1);
+}
+
+static void flush_committed()
+{
+	ullong64 committed = atomic_load_explicit(&recorder.committed, memory_order_acquire);
+	ullong64 flushed = atomic_load_explicit(&recorder.flushed, memory_order_relaxed);
+	ullong64 slot_count = recorder.config.slot_count;
+
+	if(committed == flushed)
+		return;
+
+	// Slots reused before they were flushed, only with LAL_RECORD_DROP_OLDEST
+	if(committed - flushed > slot_count)
+	{
+		atomic_fetch_add(&recorder.dropped, committed - flushed - slot_count);
+		flushed = committed - slot_count;
+	}
+
+	flush_frames(flushed, committed);
+	atomic_store_explicit(&recorder.flushed, committed, memory_order_release);
+}
+
+static void *run_writer(void *arg)
+{
+	(void)arg;
+
+	for(;;)
+	{
+		while(sem_wait(&recorder.pending) != 0)
+			;
+
+		flush_committed();
+
+		if(atomic_load(&recorder.stop))
+			break;
+	}
+
+	flush_committed();
+	return NULL;
+}
+
+static void write_file_header()
+{
+	const LalRecorderConfig *config = &recorder.config;
+
+	if(config->format == LAL_RECORD_Y4M)
+	{
+		// The terminator lands on the first slot and is overwritten with it
+		snprintf((char *)recorder.map, (size_t)recorder.data_offset + 1, Y4M_STREAM_HEADER,
+			config->width, config->height, config->fps);
+		return;
+	}
+
+	LalRecordFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, LAL_RECORD_MAGIC, sizeof(LAL_RECORD_MAGIC));
+	header.version = LAL_RECORD_VERSION;
+	header.width = config->width;
+	header.height = config->height;
+	header.stride = config->width * 4;
+	header.slot_count = config->slot_count;
+	header.slot_size = recorder.slot_size;
+	header.data_offset = recorder.data_offset;
+	memcpy(recorder.map, &header, sizeof(header));
+}
+
+b8 lal_recorder_start(const LalRecorderConfig *config)
+{
+	ullong64 pixels;
+	ullong64 file_size;
+
+	if(atomic_load(&recorder.running))
+		return FAILED;
+
+	if(config->path == NULL || config->width == 0 || config->height == 0 || config->slot_count < 2)
+	{
+		LAL_ERROR("Invalid recorder configuration.");
+		return FAILED;
+	}
+
+	recorder.config = *config;
+	if(recorder.config.fps == 0)
+		recorder.config.fps = 60;
+	pixels = (ullong64)config->width * config->height;
+
+	if(config->format == LAL_RECORD_Y4M)
+	{
+		recorder.data_offset = (ullong64)snprintf(NULL, 0, Y4M_STREAM_HEADER,
+			config->width, config->height, recorder.config.fps);
+		recorder.slot_size = Y4M_FRAME_HEADER_SIZE + pixels * 3;
+	}
+	else
+	{
+		recorder.data_offset = RECORD_PAGE_SIZE;
+		recorder.slot_size = RECORD_ALIGN(sizeof(LalRecordSlotHeader)) + RECORD_ALIGN(pixels * 4);
+	}
+
+	// A Y4M file ends with its last frame, only the mapping is page aligned
+	file_size = recorder.data_offset + recorder.slot_size * config->slot_count;
+	recorder.map_size = (size_t)RECORD_ALIGN(file_size);
+
+	recorder.fd = open(config->path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if(recorder.fd < 0)
+	{
+		LAL_ERROR("Failed to create recording %s.", config->path);
+		return FAILED;
+	}
+
+	// Reserve the blocks now, writeback must not fail on a full disk later.
+	// A sparse file would, so there is no ftruncate fallback.
+	if(posix_fallocate(recorder.fd, 0, (off_t)file_size) != 0)
+	{
+		LAL_ERROR("Failed to allocate recording %s.", config->path);
+		close(recorder.fd);
+		return FAILED;
+	}
+
+	// Populated up front so the first lap does not fault on the capture thread
+	recorder.map = mmap(NULL, recorder.map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, recorder.fd, 0);
+	if(recorder.map == MAP_FAILED)
+	{
+		LAL_ERROR("Failed to map recording %s.", config->path);
+		close(recorder.fd);
+		return FAILED;
+	}
+
+	// Keeps flushed pages from being evicted and read back on the next lap.
+	// Large rings usually exceed RLIMIT_MEMLOCK, that only costs latency.
+	if(mlock(recorder.map, recorder.map_size) != 0)
+		LAL_DEBUG("Recording is not locked in memory.");
+
+	write_file_header();
+
+	atomic_init(&recorder.committed, 0);
+	atomic_init(&recorder.flushed, 0);
+	atomic_init(&recorder.dropped, 0);
+	atomic_init(&recorder.writing_slot, -1);
+	atomic_init(&recorder.flushing_slot, -1);
+	atomic_init(&recorder.stop, 0);
+	sem_init(&recorder.pending, 0, 0);
+
+	if(pthread_create(&recorder.writer, NULL, run_writer, NULL) != 0)
+	{
+		LAL_ERROR("Failed to start recorder thread.");
+		sem_destroy(&recorder.pending);
+		munmap(recorder.map, recorder.map_size);
+		close(recorder.fd);
+		return FAILED;
+	}
+
+	atomic_store(&recorder.running, 1);
+
+	return OK;
+}
+
+void lal_recorder_stop()
+{
+	if(!atomic_exchange(&recorder.running, 0))
+		return;
+
+	// New writes see running cleared, the ones already in the mapping finish
+	while(atomic_load(&recorder.writers) > 0)
+		sched_yield();
+
+	atomic_store(&recorder.stop, 1);
+	sem_post(&recorder.pending);
+	pthread_join(recorder.writer, NULL);
+
+	// Header and any slot the writer skipped
+	if(msync(recorder.map, recorder.map_size, MS_SYNC) != 0)
+		LAL_WARN("Failed to flush recording.");
+
+	sem_destroy(&recorder.pending);
+	munmap(recorder.map, recorder.map_size);
+	close(recorder.fd);
+}
+
+// Copies BGRA rows, flipping the bottom-up frame
+static void write_raw_slot(uchar8 *slot, const LalCaptureFrame *frame, ullong64 sequence)
+{
+	volatile LalRecordSlotHeader *header = (volatile LalRecordSlotHeader *)slot;
+	uchar8 *pixels = slot + RECORD_ALIGN(sizeof(LalRecordSlotHeader));
+	size_t row = (size_t)frame->width * 4;
+
+	// A slot torn by a crash keeps sequence 0 and is skipped on replay
+	header->sequence = 0;
+	atomic_thread_fence(memory_order_release);
+
+	for(uint32 y = 0; y < frame->height; y++)
+		memcpy(pixels + y * row, frame->pixels + (size_t)(frame->height - 1 - y) * frame->stride, row);
+
+	header->index = frame->index;
+	header->timestamp_ns = frame->timestamp_ns;
+	atomic_thread_fence(memory_order_release);
+	header->sequence = sequence;
+}
+
+// BT.601 limited range, planar 4:4:4, top row first
+static void write_y4m_slot(uchar8 *slot, const LalCaptureFrame *frame)
+{
+	char frame_header[Y4M_FRAME_HEADER_SIZE + 1];
+	size_t plane = (size_t)frame->width * frame->height;
+	uchar8 *y_plane = slot + Y4M_FRAME_HEADER_SIZE;
+	uchar8 *u_plane = y_plane + plane;
+	uchar8 *v_plane = u_plane + plane;
+
+	for(uint32 y = 0; y < frame->height; y++)
+	{
+		const uchar8 *source = frame->pixels + (size_t)(frame->height - 1 - y) * frame->stride;
+		size_t offset = (size_t)y * frame->width;
+
+		for(uint32 x = 0; x < frame->width; x++)
+		{
+			sint32 b = source[x * 4 + 0];
+			sint32 g = source[x * 4 + 1];
+			sint32 r = source[x * 4 + 2];
+
+			y_plane[offset + x] = (uchar8)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+			u_plane[offset + x] = (uchar8)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+			v_plane[offset + x] = (uchar8)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+		}
+	}
+
+	snprintf(frame_header, sizeof(frame_header), "FRAME Xidx=%020llu Xpts=%020llu\n",
+		frame->index, frame->timestamp_ns);
+	memcpy(slot, frame_header, Y4M_FRAME_HEADER_SIZE);
+}
+
+static b8 write_frame(const LalCaptureFrame *frame)
+{
+	ullong64 committed;
+	sllong64 index;
+	uchar8 *slot;
+
+	if(frame->width != recorder.config.width || frame->height != recorder.config.height)
+	{
+		atomic_fetch_add(&recorder.dropped, 1);
+		return FAILED;
+	}
+
+	committed = atomic_load_explicit(&recorder.committed, memory_order_relaxed);
+	if(recorder.config.drop_policy == LAL_RECORD_DROP_NEWEST
+			&& committed - atomic_load_explicit(&recorder.flushed, memory_order_acquire) >= recorder.config.slot_count)
+	{
+		atomic_fetch_add(&recorder.dropped, 1);
+		return FAILED;
+	}
+
+	// Writing into a slot under msync would wait on stable page writeback,
+	// the frame is dropped instead
+	index = (sllong64)(committed % recorder.config.slot_count);
+	atomic_store(&recorder.writing_slot, index);
+	if(atomic_load(&recorder.flushing_slot) == index)
+	{
+		atomic_store(&recorder.writing_slot, -1);
+		atomic_fetch_add(&recorder.dropped, 1);
+		return FAILED;
+	}
+
+	slot = recorder.map + recorder.data_offset + (ullong64)index * recorder.slot_size;
+
+	if(recorder.config.format == LAL_RECORD_Y4M)
+		write_y4m_slot(slot, frame);
+	else
+		write_raw_slot(slot, frame, committed + 1);
+
+	atomic_store(&recorder.writing_slot, -1);
+	atomic_store_explicit(&recorder.committed, committed + 1, memory_order_release);
+	sem_post(&recorder.pending);
+
+	return OK;
+}
+
+b8 lal_recorder_write(const LalCaptureFrame *frame)
+{
+	b8 result = FAILED;
+
+	// Announced before running is checked, lal_recorder_stop waits for it
+	atomic_fetch_add(&recorder.writers, 1);
+	if(atomic_load(&recorder.running))
+		result = write_frame(frame);
+	atomic_fetch_sub(&recorder.writers, 1);
+
+	return result;
+}
+
+void lal_recorder_capture_callback(void *user_data, const LalCaptureFrame *frame)
+{
+	(void)user_data;
+	lal_recorder_write(frame);
+}
+
+ullong64 lal_recorder_frames()
+{
+	return atomic_load(&recorder.committed);
+}
+
+ullong64 lal_recorder_dropped()
+{
+	return atomic_load(&recorder.dropped);
+}
+
+#endif // LPLATFORM_LINUX
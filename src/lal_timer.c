@@ -0,0 +1,489 @@
+#include "lal_defines.h"
+#include "lal_error_list.h"
+#include "lal/lal_timer.h"
+#include "lal/lal_window.h"
+#include "lal/lal_log.h"
+
+#if LPLATFORM_LINUX
+
+#include <sys/timerfd.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// Wheel resolution. Deadlines keep their nanoseconds, the tick only picks
+// the slot, and the timerfd is armed for the exact earliest deadline.
+#define TIMER_TICK_NS 1000000ULL
+
+// 5 levels of 64 slots reach 2^30 ticks, about 12 days. Later deadlines
+// sit in the last level and are cascaded again until they come in range.
+#define TIMER_LEVELS 5
+#define TIMER_SLOT_BITS 6
+#define TIMER_SLOTS (1 << TIMER_SLOT_BITS)
+#define TIMER_SLOT_MASK (TIMER_SLOTS - 1)
+#define TIMER_RANGE (1ULL << (TIMER_LEVELS * TIMER_SLOT_BITS))
+
+// Handles pack the pool index + 1 and a generation, so stale handles of a
+// reused entry are ignored
+#define TIMER_INDEX_MASK 0xFFFF
+#define TIMER_GENERATION_SHIFT 16
+
+typedef struct Timer
+{
+	ullong64 expires_ns;
+	ullong64 period_ns;
+	LalTimerCallback callback;
+	void *user_data;
+
+	// Links by pool index, -1 ends the list
+	sint32 prev;
+	sint32 next;
+
+	// Head of the list the timer is in, NULL while free or firing
+	sint32 *list;
+
+	uint32 generation;
+	b8 in_use;
+	b8 firing;
+	b8 cancelled;
+} Timer;
+
+static Timer timers[LAL_MAX_TIMERS];
+static sint32 free_head = -1;
+static uint32 active_count;
+
+static sint32 slots[TIMER_LEVELS][TIMER_SLOTS];
+static ullong64 occupied[TIMER_LEVELS];
+
+// Due timers waiting for their callback
+static sint32 expired_head = -1;
+static sint32 expired_tail = -1;
+
+// First tick that has not been fully processed
+static ullong64 current_tick;
+static ullong64 base_ns;
+
+static sint32 timer_fd = -1;
+
+// 0 when disarmed
+static ullong64 armed_ns;
+
+// Set while callbacks run, the dispatch rearms once they are done
+static b8 dispatching;
+
+static ullong64 monotonic_ns()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (ullong64)now.tv_sec * 1000000000ULL + (ullong64)now.tv_nsec;
+}
+
+static ullong64 tick_of(ullong64 ns)
+{
+	return ns > base_ns ? (ns - base_ns) / TIMER_TICK_NS : 0;
+}
+
+static LalTimer handle_of(sint32 index)
+{
+	return ((timers[index].generation & TIMER_INDEX_MASK) << TIMER_GENERATION_SHIFT) | (uint32)(index + 1);
+}
+
+static sint32 index_of(LalTimer timer)
+{
+	sint32 index = (sint32)(timer & TIMER_INDEX_MASK) - 1;
+	if(index < 0 || index >= LAL_MAX_TIMERS || !timers[index].in_use)
+		return -1;
+	if(((timers[index].generation & TIMER_INDEX_MASK) << TIMER_GENERATION_SHIFT) != (timer & ~(uint32)TIMER_INDEX_MASK))
+		return -1;
+
+	return index;
+}
+
+static void unlink_timer(sint32 index)
+{
+	Timer *timer = &timers[index];
+	if(timer->list == NULL)
+		return;
+
+	if(timer->prev >= 0)
+		timers[timer->prev].next = timer->next;
+	else
+		*timer->list = timer->next;
+
+	if(timer->next >= 0)
+		timers[timer->next].prev = timer->prev;
+	else if(timer->list == &expired_head)
+		expired_tail = timer->prev;
+
+	// Wheel slots keep their occupancy bit in sync
+	if(*timer->list < 0 && timer->list != &expired_head)
+	{
+		ullong64 slot = (ullong64)(timer->list - &slots[0][0]);
+		occupied[slot / TIMER_SLOTS] &= ~(1ULL << (slot % TIMER_SLOTS));
+	}
+
+	timer->list = NULL;
+}
+
+static void push_timer(sint32 *list, sint32 index)
+{
+	Timer *timer = &timers[index];
+	timer->prev = -1;
+	timer->next = *list;
+	timer->list = list;
+	if(*list >= 0)
+		timers[*list].prev = index;
+	*list = index;
+}
+
+// Callbacks run in the order their timers expired
+static void append_expired(sint32 index)
+{
+	Timer *timer = &timers[index];
+	timer->prev = expired_tail;
+	timer->next = -1;
+	timer->list = &expired_head;
+	if(expired_tail >= 0)
+		timers[expired_tail].next = index;
+	else
+		expired_head = index;
+	expired_tail = index;
+}
+
+// The level is picked by the distance to current_tick, the slot by the
+// expiry tick itself. A slot is cascaded when current_tick enters its
+// range, never after its timers are due.
+static void insert_timer(sint32 index)
+{
+	ullong64 expires = tick_of(timers[index].expires_ns);
+	if(expires < current_tick)
+		expires = current_tick;
+
+	ullong64 delta = expires - current_tick;
+	if(delta >= TIMER_RANGE)
+	{
+		delta = TIMER_RANGE - 1;
+		expires = current_tick + delta;
+	}
+
+	uint32 level = 0;
+	while(delta >= (1ULL << ((level + 1) * TIMER_SLOT_BITS)))
+		level++;
+
+	uint32 slot = (uint32)(expires >> (level * TIMER_SLOT_BITS)) & TIMER_SLOT_MASK;
+	push_timer(&slots[level][slot], index);
+	occupied[level] |= 1ULL << slot;
+}
+
+// First occupied slot of a level going round from the current position
+static sint32 first_slot(uint32 level, ullong64 *tick)
+{
+	if(occupied[level] == 0)
+		return -1;
+
+	// Blocks that started before current_tick were cascaded, the one
+	// starting at it is still pending
+	uint32 shift = level * TIMER_SLOT_BITS;
+	ullong64 block = (current_tick + (1ULL << shift) - 1) >> shift;
+
+	uint32 start = (uint32)block & TIMER_SLOT_MASK;
+	ullong64 rotated = (occupied[level] >> start) | (start ? occupied[level] << (TIMER_SLOTS - start) : 0);
+	uint32 distance = (uint32)__builtin_ctzll(rotated);
+
+	*tick = (block + distance) << shift;
+
+	return (sint32)((start + distance) & TIMER_SLOT_MASK);
+}
+
+static b8 next_tick(ullong64 *tick)
+{
+	b8 found = FALSE;
+	for(uint32 level = 0; level < TIMER_LEVELS; level++)
+	{
+		ullong64 candidate;
+		if(first_slot(level, &candidate) >= 0 && (!found || candidate < *tick))
+		{
+			*tick = candidate;
+			found = TRUE;
+		}
+	}
+	return found;
+}
+
+// The earliest timer of a level is in its first occupied slot
+static ullong64 earliest_deadline()
+{
+	ullong64 earliest = 0;
+	for(uint32 level = 0; level < TIMER_LEVELS; level++)
+	{
+		ullong64 tick;
+		sint32 slot = first_slot(level, &tick);
+		if(slot < 0)
+			continue;
+
+		for(sint32 i = slots[level][slot]; i >= 0; i = timers[i].next)
+		{
+			if(earliest == 0 || timers[i].expires_ns < earliest)
+				earliest = timers[i].expires_ns;
+		}
+	}
+	return earliest;
+}
+
+static void arm(ullong64 deadline_ns)
+{
+	struct itimerspec spec;
+	memset(&spec, 0, sizeof(spec));
+
+	// A zero it_value disarms, due deadlines still need a wakeup
+	if(deadline_ns != 0)
+	{
+		spec.it_value.tv_sec = (time_t)(deadline_ns / 1000000000ULL);
+		spec.it_value.tv_nsec = (long)(deadline_ns % 1000000000ULL);
+		if(spec.it_value.tv_sec == 0 && spec.it_value.tv_nsec == 0)
+			spec.it_value.tv_nsec = 1;
+	}
+
+	timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &spec, NULL);
+	armed_ns = deadline_ns;
+}
+
+// Moves the timers due at now_ns to the expired list, cascading every
+// slot whose range started on the way
+static void advance(ullong64 now_ns)
+{
+	ullong64 now_tick = tick_of(now_ns);
+	ullong64 tick = 0;
+
+	while(next_tick(&tick) && tick <= now_tick)
+	{
+		current_tick = tick;
+
+		// Top down, so cascaded timers land in slots processed below
+		for(uint32 level = TIMER_LEVELS - 1; level > 0; level--)
+		{
+			uint32 shift = level * TIMER_SLOT_BITS;
+			if((current_tick & ((1ULL << shift) - 1)) != 0)
+				continue;
+
+			uint32 slot = (uint32)(current_tick >> shift) & TIMER_SLOT_MASK;
+			sint32 index = slots[level][slot];
+			slots[level][slot] = -1;
+			occupied[level] &= ~(1ULL << slot);
+
+			while(index >= 0)
+			{
+				sint32 next = timers[index].next;
+				timers[index].list = NULL;
+				insert_timer(index);
+				index = next;
+			}
+		}
+
+		sint32 *slot = &slots[0][current_tick & TIMER_SLOT_MASK];
+		for(sint32 i = *slot; i >= 0;)
+		{
+			sint32 next = timers[i].next;
+			if(timers[i].expires_ns <= now_ns)
+			{
+				unlink_timer(i);
+				append_expired(i);
+			}
+			i = next;
+		}
+
+		// The rest of the current tick is not due yet
+		if(*slot >= 0 || tick == now_tick)
+			return;
+
+		current_tick = tick + 1;
+	}
+
+	if(current_tick < now_tick)
+		current_tick = now_tick;
+}
+
+static void release_timer(sint32 index)
+{
+	Timer *timer = &timers[index];
+	timer->in_use = FALSE;
+	timer->firing = FALSE;
+	timer->generation++;
+	timer->next = free_head;
+	free_head = index;
+	active_count--;
+}
+
+static void fire_expired(ullong64 now_ns)
+{
+	while(expired_head >= 0)
+	{
+		sint32 index = expired_head;
+		Timer *timer = &timers[index];
+		unlink_timer(index);
+
+		timer->firing = TRUE;
+		timer->cancelled = FALSE;
+		timer->callback(timer->user_data, handle_of(index));
+		timer->firing = FALSE;
+
+		if(timer->cancelled || timer->period_ns == 0)
+		{
+			release_timer(index);
+			continue;
+		}
+
+		// Missed periods are skipped rather than fired back to back
+		timer->expires_ns += timer->period_ns;
+		if(timer->expires_ns <= now_ns)
+			timer->expires_ns += ((now_ns - timer->expires_ns) / timer->period_ns + 1) * timer->period_ns;
+		insert_timer(index);
+	}
+}
+
+static void dispatch_timers(void *user_data)
+{
+	(void)user_data;
+	lal_timer_dispatch();
+}
+
+b8 lal_timer_initialize()
+{
+	if(timer_fd >= 0)
+		return OK;
+
+	timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if(timer_fd < 0)
+	{
+		LAL_ERROR("Failed to create timer descriptor.");
+		return FAILED;
+	}
+
+	free_head = -1;
+	for(sint32 i = LAL_MAX_TIMERS - 1; i >= 0; i--)
+	{
+		memset(&timers[i], 0, sizeof(Timer));
+		timers[i].next = free_head;
+		free_head = i;
+	}
+	for(uint32 level = 0; level < TIMER_LEVELS; level++)
+	{
+		for(uint32 slot = 0; slot < TIMER_SLOTS; slot++)
+			slots[level][slot] = -1;
+		occupied[level] = 0;
+	}
+
+	expired_head = -1;
+	expired_tail = -1;
+	active_count = 0;
+	armed_ns = 0;
+	dispatching = FALSE;
+	current_tick = 0;
+	base_ns = monotonic_ns();
+
+	if(add_wait_source(timer_fd, dispatch_timers, NULL) != OK)
+	{
+		close(timer_fd);
+		timer_fd = -1;
+		return FAILED;
+	}
+
+	return OK;
+}
+
+void lal_timer_shutdown()
+{
+	if(timer_fd < 0)
+		return;
+
+	remove_wait_source(timer_fd);
+	close(timer_fd);
+
+	timer_fd = -1;
+	armed_ns = 0;
+	active_count = 0;
+}
+
+LalTimer lal_timer_add(ullong64 delay_ns, ullong64 period_ns, LalTimerCallback callback, void *user_data)
+{
+	if(timer_fd < 0 || callback == NULL)
+		return LAL_TIMER_INVALID;
+
+	if(free_head < 0)
+	{
+		LAL_WARN("Out of timers.");
+		return LAL_TIMER_INVALID;
+	}
+
+	sint32 index = free_head;
+	Timer *timer = &timers[index];
+	free_head = timer->next;
+
+	timer->expires_ns = monotonic_ns() + delay_ns;
+	timer->period_ns = period_ns;
+	timer->callback = callback;
+	timer->user_data = user_data;
+	timer->list = NULL;
+	timer->in_use = TRUE;
+	timer->firing = FALSE;
+	timer->cancelled = FALSE;
+	active_count++;
+
+	insert_timer(index);
+
+	// Only an earlier deadline costs a syscall, adds from a callback are
+	// picked up when the dispatch rearms
+	if(!dispatching && (armed_ns == 0 || timer->expires_ns < armed_ns))
+		arm(timer->expires_ns);
+
+	return handle_of(index);
+}
+
+void lal_timer_cancel(LalTimer timer)
+{
+	sint32 index = index_of(timer);
+	if(index < 0)
+		return;
+
+	// Released once its callback returns
+	if(timers[index].firing)
+	{
+		timers[index].cancelled = TRUE;
+		return;
+	}
+
+	// The timerfd may still wake up for it, the dispatch then rearms
+	unlink_timer(index);
+	release_timer(index);
+}
+
+void lal_timer_dispatch()
+{
+	if(timer_fd < 0 || dispatching)
+		return;
+
+	// Clears the readiness, fails with EAGAIN before the deadline
+	ullong64 expirations;
+	ssize_t size = read(timer_fd, &expirations, sizeof(expirations));
+	(void)size;
+
+	ullong64 now = monotonic_ns();
+	dispatching = TRUE;
+	advance(now);
+	fire_expired(now);
+	dispatching = FALSE;
+
+	arm(earliest_deadline());
+}
+
+uint32 lal_timer_count()
+{
+	return active_count;
+}
+
+sint32 lal_timer_fd()
+{
+	return timer_fd;
+}
+
+#endif // LPLATFORM_LINUX
@@ -2,718 +2,1001 @@
 #include "lal_error_list.h"
 #include "lal/lal_window.h"
 #include "lal/lal_input.h"
+#include "lal/lal_gl.h"
+#include "lal/lal_capture.h"
+#include "lal/lal_memory.h"
+#include "lal/lal_event.h"
+#include "lal/lal_log.h"
+#include "lal_window_internal.h"
 
 #if LPLATFORM_LINUX
 
-#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
 
-#include <X11/X.h>
-#include <X11/Xlib.h>
-#include <X11/Xutil.h>
+typedef struct RenderThread
+{
+    pthread_t thread;
+    PlatformHandler *platform_handler;
+    RenderCallback render;
+    void *user_data;
+    Display *display;
+    GLXDrawable drawable;
+    GLXContext context;
 
-#include <X11/Xlib-xcb.h>
-#include <X11/XKBlib.h>
+    // Written by the event thread: width << 32 | height
+    atomic_ullong size;
+    atomic_int running;
+} RenderThread;
 
-#define GLX_GLXEXT_PROTOTYPES
-#include <GL/glx.h>
-#include <GL/glxext.h>
+static b8 window_threads_initialized = FALSE;
 
-typedef GLXContext (*glXCreateContextAttribsARBProc)(Display*, GLXFBConfig, GLXContext, Bool, const int*);
+// Xlib's error handler is process wide, errors are routed by display
+#define LAL_MAX_ERROR_DISPLAYS 16
 
-typedef struct WindowX11
+typedef struct ErrorDisplay
 {
-	Display *display;
-	ulong32 id;
-	Screen screen;
-	ulong32 delete_msg;
-} WindowX11;
+    Display *display;
+    PlatformHandler *platform_handler;
+} ErrorDisplay;
+
+static ErrorDisplay error_displays[LAL_MAX_ERROR_DISPLAYS];
 
-typedef struct WindowX11GL
+// Descriptors polled together with the X connection
+#define LAL_MAX_WAIT_SOURCES 8
+
+typedef struct WaitSource
 {
-	Display *display;
-	ulong32 id;
-	Screen *screen;
-    sint32 screen_id;
-	ulong32 delete_msg;
-    GLXContext context;
-    XWindowAttributes window_attribs;
-} WindowX11GL;
+    sint32 fd;
+    WaitSourceCallback dispatch;
+    void *user_data;
+} WaitSource;
 
-typedef struct WindowXCBGL
+static WaitSource wait_sources[LAL_MAX_WAIT_SOURCES];
+static uint32 wait_source_count = 0;
+static XErrorHandler previous_error_handler = NULL;
+static b8 error_handler_installed = FALSE;
+
+#if LAL_WINDOW_BACKEND_PINNED == LAL_BACKEND_RUNTIME
+
+// The simple window has no title
+static b8 create_simple_window_titled(PlatformHandler *platform_handler, const char *window_title,
+        uint32 x, uint32 y, uint32 width, uint32 height)
 {
-	Display *display;
-    ulong32 x11_id;
-    sint32 screen_id;
-	uint32 xcb_id;
-    xcb_connection_t *xcb_connection;
-    xcb_screen_t *xcb_screen;
-    uint32 delete_msg;
-	uint32 wm_protocols;
-    XWindowAttributes window_attribs;
-    GLXContext context;
-    ulong32 glx_id;
-    uint32 xcb_colormap;
-    GLXFBConfig glx_fb_config;
-} WindowXCBGL;
-
-Keys translate_keycode(uint32 key);
-b8 isExtensionSupported(const char *extList, const char *extension);
-
-b8 create_simple_window(
-		PlatformHandler *platform_handler,
-		uint32 x,
-		uint32 y,
-		uint32 width,
-		uint32 height)
+    return create_simple_window(platform_handler, x, y, width, height);
+}
+
+const WindowBackendVTable window_backends[] = {
+    { create_simple_window_titled, run_simple_window, shutdown_simple_window,
+        process_simple_window_events, poll_simple_window_events },
+    { create_gl_xlib_window, run_gl_xlib_window, shutdown_gl_xlib_window,
+        process_gl_xlib_events, poll_gl_xlib_events },
+    { create_xcb_window, run_xcb_window, shutdown_xcb_window,
+        process_xcb_events, poll_xcb_events },
+};
+
+#endif // LAL_WINDOW_BACKEND_PINNED
+
+void initialize_platform_handler(PlatformHandler *platform_handler, WindowBackend backend,
+        uint32 width, uint32 height)
 {
-	// Create WindowX11
-	platform_handler->window = malloc(sizeof(WindowX11));
-	WindowX11 *window = (WindowX11 *)platform_handler->window;
-	
-	// Open a connection to X server
-	window->display = XOpenDisplay(NULL);
-	if(window->display == NULL)
-	{
-		printf("ERROR: Failed to open display.\n");
-		return WINDOW_ERROR;
-	}
+    platform_handler->window = NULL;
+    platform_handler->running = FALSE;
+    platform_handler->backend = backend;
+    platform_handler->input_features = INPUT_FEATURE_DEFAULT;
+    platform_handler->mapped = FALSE;
+    platform_handler->obscured = FALSE;
+    platform_handler->focused = FALSE;
+    platform_handler->raw_keyboard = FALSE;
+    platform_handler->pointer_locked = FALSE;
+    platform_handler->pointer_lock_active = FALSE;
+    platform_handler->xi_opcode = -1;
+    platform_handler->xi_minor = 0;
+    for(uint32 i = 0; i < LAL_POINTER_BARRIERS; i++)
+        platform_handler->pointer_barriers[i] = None;
+    platform_handler->fullscreen_mode = FULLSCREEN_OFF;
+    platform_handler->windowed_x = 0;
+    platform_handler->windowed_y = 0;
+    platform_handler->windowed_width = width;
+    platform_handler->windowed_height = height;
+    platform_handler->last_wake_ns = 0;
+    platform_handler->last_server_time = 0;
+    platform_handler->width = width;
+    platform_handler->height = height;
+    platform_handler->render_thread = NULL;
+    platform_handler->capture = NULL;
+    platform_handler->clipboard = NULL;
+    platform_handler->monitors = NULL;
+    platform_handler->x_error_count = 0;
+    platform_handler->x_error_checked = 0;
+    platform_handler->x_error_callback = NULL;
+    platform_handler->x_error_user_data = NULL;
+
+    // Nothing to draw for invisible windows, sleep until something happens
+    set_idle_policy(platform_handler, WINDOW_UNMAPPED, IDLE_POLICY_BLOCK, 0);
+    set_idle_policy(platform_handler, WINDOW_OBSCURED, IDLE_POLICY_BLOCK, 0);
+    set_idle_policy(platform_handler, WINDOW_UNFOCUSED, IDLE_POLICY_POLL, 0);
+    set_idle_policy(platform_handler, WINDOW_ACTIVE, IDLE_POLICY_POLL, 0);
+}
+
+// Detectable auto-repeat only affects this client, unlike XAutoRepeatOff
+void enable_detectable_auto_repeat(Display *display)
+{
+    Bool supported = False;
+    XkbSetDetectableAutoRepeat(display, True, &supported);
 
-	// Setup window config
-	window->id = XCreateSimpleWindow(
-			window->display,					// display
-			DefaultRootWindow(window->display),	// parent
-			x,									// x pos
-			y,									// y pos
-			width,								// width
-			height,								// height
-			0,									// border width
-			0,									// border
-			0);									// background
-
-	// Report events associated with specified event mask
-	XSelectInput(window->display, window->id, KeyPressMask | KeyReleaseMask);
-
-	// Map window by client application
-	XMapWindow(window->display, window->id);
-	
-	// Flush output buffer and wait for requests processed by X server
-	XSync(window->display, 0);
-	
-	// Variable to hold the delete window message
-	window->delete_msg = XInternAtom(window->display, "WM_DELETE_WINDOW", 0);
-	XSetWMProtocols(window->display, window->id, &window->delete_msg, 1);
-
-	// Disable key repeat
-	XAutoRepeatOff(window->display);
-
-	// Initialize Input system
-	input_initialize();
-
-	// Set running to false
-	platform_handler->running = TRUE;
-
-	return OK;
+    if(!supported)
+        LAL_WARN("Detectable auto-repeat is not supported.");
 }
 
-b8 create_gl_xlib_window(
-		PlatformHandler *platform_handler,
-		const char* window_title,
-		uint32 x,
-		uint32 y,
-		uint32 width,
-		uint32 height)
+// Without detectable auto-repeat the server sends a repeat as a release
+// immediately followed by a press with the same timestamp
+static b8 is_xlib_key_repeat(Display *display, XEvent *release, XEvent *next_event)
 {
-    platform_handler->window = malloc(sizeof(WindowX11GL));
-    WindowX11GL *window = (WindowX11GL *)platform_handler->window;
+    if(XEventsQueued(display, QueuedAfterReading) == 0)
+        return FALSE;
 
-    // Open Display
-    window->display = XOpenDisplay(NULL);
-    if(window->display == NULL)
+    XPeekEvent(display, next_event);
+    if(next_event->type != KeyPress
+            || next_event->xkey.keycode != release->xkey.keycode
+            || next_event->xkey.time != release->xkey.time)
+        return FALSE;
+
+    // Consume the press, it is reported as the repeat
+    XNextEvent(display, next_event);
+
+    return TRUE;
+}
+
+Display *get_x_window(PlatformHandler *platform_handler, ulong32 *window)
+{
+    switch(platform_handler->backend)
     {
-        printf("ERROR: Failed to open display.\n");
-        return WINDOW_ERROR;
+        case WINDOW_BACKEND_SIMPLE:
+            *window = ((WindowX11 *)platform_handler->window)->id;
+            return ((WindowX11 *)platform_handler->window)->display;
+        case WINDOW_BACKEND_GL_XLIB:
+            *window = ((WindowX11GL *)platform_handler->window)->id;
+            return ((WindowX11GL *)platform_handler->window)->display;
+        case WINDOW_BACKEND_XCB:
+            *window = ((WindowXCBGL *)platform_handler->window)->xcb_id;
+            return ((WindowXCBGL *)platform_handler->window)->display;
+        default:
+            return NULL;
     }
+}
+
+// Core protocol event mask for the window, Xlib and XCB share the values
+ulong32 event_mask_for(PlatformHandler *platform_handler)
+{
+    uint32 features = platform_handler->input_features;
+
+    // Always needed for window state tracking and selection transfers
+    ulong32 mask = StructureNotifyMask | VisibilityChangeMask | FocusChangeMask | PropertyChangeMask;
+
+    if(platform_handler->backend != WINDOW_BACKEND_SIMPLE)
+        mask |= ExposureMask;
+
+    if(features & INPUT_FEATURE_KEYBOARD)
+        mask |= KeyPressMask | KeyReleaseMask;
+
+    if(features & INPUT_FEATURE_MOUSE_BUTTONS)
+        mask |= ButtonPressMask | ButtonReleaseMask;
+
+    if(features & INPUT_FEATURE_MOUSE_MOTION)
+        mask |= PointerMotionMask;
+
+    if(features & INPUT_FEATURE_POINTER_CROSSING)
+        mask |= EnterWindowMask | LeaveWindowMask;
+
+    return mask;
+}
 
-    // Initialize Screen
-    window->screen = DefaultScreenOfDisplay(window->display);
-    window->screen_id = DefaultScreen(window->display);
-    
-    printf("Finding GL versions...\n");
-    sint32 major_version = 0;
-    sint32 minor_version = 0;
-
-    // Get GL versions
-    glXQueryVersion(window->display, &major_version, &minor_version);
-    if(major_version <= 1 && minor_version < 2)
+static ullong64 platform_time_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ullong64)ts.tv_sec * 1000000000ull + (ullong64)ts.tv_nsec;
+}
+
+// Applies the rate cap of the current idle policy, returns the poll() timeout
+// to use when no event is pending: -1 to block, 0 to return right away
+sint32 apply_idle_policy(PlatformHandler *platform_handler)
+{
+    IdlePolicy *policy = &platform_handler->idle_policies[get_window_activity(platform_handler)];
+    ullong64 now = platform_time_ns();
+
+    if(policy->mode == IDLE_POLICY_BLOCK)
+        return -1;
+
+    if(policy->mode == IDLE_POLICY_CAP_RATE && policy->rate_hz > 0)
     {
-        printf("ERROR: GLX 1.2 or greater is required.\n");
-        XCloseDisplay(window->display);
-        return CONTEXT_ERROR;
+        ullong64 next_wake = platform_handler->last_wake_ns + 1000000000ull / policy->rate_hz;
+        if(now < next_wake)
+        {
+            struct timespec ts;
+            ts.tv_sec = (time_t)(next_wake / 1000000000ull);
+            ts.tv_nsec = (long)(next_wake % 1000000000ull);
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+            now = next_wake;
+        }
     }
 
-    printf("GLX version: %d.%d\n", major_version, minor_version);
-
-    sint32 glx_attribs[] = {
-        GLX_X_RENDERABLE,   True,
-		GLX_DRAWABLE_TYPE,  GLX_WINDOW_BIT,
-		GLX_RENDER_TYPE,    GLX_RGBA_BIT,
-		GLX_X_VISUAL_TYPE,  GLX_TRUE_COLOR,
-		GLX_RED_SIZE,       8,
-		GLX_GREEN_SIZE,     8,
-		GLX_BLUE_SIZE,      8,
-		GLX_ALPHA_SIZE,     8,
-		GLX_DEPTH_SIZE,     24,
-		GLX_STENCIL_SIZE,   8,
-		GLX_DOUBLEBUFFER,   True,
-		None
-    };
-
-    // Get framebuffer info
-    sint32 fb_count;
-    GLXFBConfig *fbc = glXChooseFBConfig(window->display, window->screen_id, glx_attribs, &fb_count);
-    if(fbc == NULL)
+    platform_handler->last_wake_ns = now;
+
+    return 0;
+}
+
+void wait_for_connection(sint32 fd, sint32 timeout_ms)
+{
+    struct pollfd pfds[1 + LAL_MAX_WAIT_SOURCES];
+    uint32 count = wait_source_count;
+
+    // poll skips negative descriptors
+    pfds[0].fd = fd;
+    pfds[0].events = POLLIN;
+    pfds[0].revents = 0;
+
+    for(uint32 i = 0; i < count; i++)
     {
-        printf("ERROR: Failed to retrieve framebuffer.\n");
-        XCloseDisplay(window->display);
-        return CONTEXT_ERROR;
+        pfds[i + 1].fd = wait_sources[i].fd;
+        pfds[i + 1].events = POLLIN;
+        pfds[i + 1].revents = 0;
     }
-    
-    printf("Getting best XVisualInfo.\n");
-    sint32 best_fbc = -1;
-    sint32 worst_fbc = -1;
-    sint32 best_num_samples = -1;
-    sint32 worst_num_samples = 999;
-    for(int i = 0; i < fb_count; i++)
-    {
-		XVisualInfo *temp_vi = glXGetVisualFromFBConfig(window->display, fbc[i]);
-		if(temp_vi != 0)
-        {
-			int samples_buf;
-            int samples;
 
-            glXGetFBConfigAttrib(window->display, fbc[i], GLX_SAMPLE_BUFFERS, &samples_buf);
-			glXGetFBConfigAttrib(window->display, fbc[i], GLX_SAMPLES       , &samples);
+    if(poll(pfds, count + 1, timeout_ms) <= 0)
+        return;
 
-			if(best_fbc < 0 || (samples_buf && samples > best_num_samples))
+    // A callback may remove sources, match by descriptor
+    for(uint32 i = 0; i < count; i++)
+    {
+        if(pfds[i + 1].revents == 0)
+            continue;
+
+        for(uint32 j = 0; j < wait_source_count; j++)
+        {
+            if(wait_sources[j].fd == pfds[i + 1].fd)
             {
-				best_fbc = i;
-				best_num_samples = samples;
-			}
+                wait_sources[j].dispatch(wait_sources[j].user_data);
+                break;
+            }
+        }
+    }
+}
 
-			if(worst_fbc < 0 || !samples_buf || samples < worst_num_samples)
-				worst_fbc = i;
+void dispatch_wait_sources()
+{
+    if(wait_source_count > 0)
+        wait_for_connection(-1, 0);
+}
 
-			worst_num_samples = samples;
-		}
+b8 add_wait_source(sint32 fd, WaitSourceCallback dispatch, void *user_data)
+{
+    if(wait_source_count == LAL_MAX_WAIT_SOURCES)
+    {
+        LAL_ERROR("Too many wait sources.");
+        return FAILED;
+    }
 
-		XFree(temp_vi);
-	}
+    wait_sources[wait_source_count].fd = fd;
+    wait_sources[wait_source_count].dispatch = dispatch;
+    wait_sources[wait_source_count].user_data = user_data;
+    wait_source_count++;
 
-    printf("Best visual info index: %d\n", best_fbc);
-    GLXFBConfig glx_fb_config = fbc[best_fbc];
-    XFree(fbc);
-    printf("Context initialized.\n");
+    return OK;
+}
 
-    // Get visual from FB config
-    XVisualInfo *visual = glXGetVisualFromFBConfig(window->display, glx_fb_config);
-    if(visual == NULL)
+void remove_wait_source(sint32 fd)
+{
+    for(uint32 i = 0; i < wait_source_count; i++)
     {
-        printf("ERROR: Failed to get visual from FB config.\n");
-        XCloseDisplay(window->display);
-        return CONTEXT_ERROR;
+        if(wait_sources[i].fd == fd)
+        {
+            wait_sources[i] = wait_sources[--wait_source_count];
+            return;
+        }
     }
+}
+
+static void set_event_time(PlatformHandler *platform_handler, LalEvent *out, uint32 time)
+{
+    platform_handler->last_server_time = time;
+    out->time = time;
+}
 
-    if(window->screen_id != visual->screen)
+b8 translate_key(PlatformHandler *platform_handler, Keys key, b8 pressed, uint32 time, LalEvent *out)
+{
+    // Every unmapped keysym is 0, sharing one key state would make a second
+    // unknown key read as an auto-repeat of the first
+    if(key == 0)
+        return FALSE;
+
+    set_event_time(platform_handler, out, time);
+    out->type = LAL_EVENT_KEY;
+    out->key.key = (ushort16)key;
+    out->key.pressed = pressed;
+    out->key.repeat = pressed && is_key_down(key);
+    out->key.device = 0;
+    return TRUE;
+}
+
+// X buttons 1-3 are left, middle and right, 4-7 are the wheel
+b8 translate_button(PlatformHandler *platform_handler, uint32 x_button, b8 pressed,
+        sshort16 x, sshort16 y, uint32 time, LalEvent *out)
+{
+    set_event_time(platform_handler, out, time);
+
+    if(x_button >= 4 && x_button <= 7)
     {
-        printf("ERROR: screen_id(%d) does not match visual->screen(%d)\n", window->screen_id, visual->screen);
-        XCloseDisplay(window->display);
-        return CONTEXT_ERROR;
+        // Each wheel step is a press/release pair, report the press only
+        if(!pressed)
+            return FALSE;
+
+        out->type = LAL_EVENT_WHEEL;
+        out->wheel.dx = x_button == 6 ? -1 : x_button == 7 ? 1 : 0;
+        out->wheel.dy = x_button == 4 ? 1 : x_button == 5 ? -1 : 0;
+        out->wheel.x = x;
+        out->wheel.y = y;
+        return TRUE;
     }
 
-    // Set window attributes - color, pixel, etc.
-    XSetWindowAttributes window_attribs;
-    window_attribs.border_pixel = BlackPixel(window->display, window->screen_id);
-    window_attribs.background_pixel = WhitePixel(window->display, window->screen_id);
-    window_attribs.override_redirect = TRUE;
-    window_attribs.colormap = XCreateColormap(window->display, 
-            RootWindow(window->display, window->screen_id), visual->visual, AllocNone);
-    window_attribs.event_mask = ExposureMask;
-
-    // Create window
-    window->id = XCreateWindow(
-        window->display,
-        RootWindow(window->display, window->screen_id),
-        0,
-        0,
-        width,
-        height, 
-        0,
-        visual->depth,
-        InputOutput,
-        visual->visual,
-        CWBackPixel | CWColormap | CWBorderPixel | CWEventMask,
-        &window_attribs);
-
-    if(window->id == 0)
+    if(x_button < 1 || x_button > 3)
+        return FALSE;
+
+    out->type = LAL_EVENT_BUTTON;
+    out->button.button = x_button == 1 ? BUTTON_LEFT : x_button == 2 ? BUTTON_MIDDLE : BUTTON_RIGHT;
+    out->button.pressed = pressed;
+    out->button.x = x;
+    out->button.y = y;
+    out->button.device = 0;
+    return TRUE;
+}
+
+b8 translate_motion(PlatformHandler *platform_handler, sshort16 x, sshort16 y, uint32 time, LalEvent *out)
+{
+    set_event_time(platform_handler, out, time);
+    out->type = LAL_EVENT_MOTION;
+    out->motion.x = x;
+    out->motion.y = y;
+    out->motion.device = 0;
+    return TRUE;
+}
+
+b8 translate_resize(PlatformHandler *platform_handler, uint32 width, uint32 height, LalEvent *out)
+{
+    // Moves send ConfigureNotify as well
+    if(width == platform_handler->width && height == platform_handler->height)
+        return FALSE;
+
+    out->type = LAL_EVENT_RESIZE;
+    out->time = platform_handler->last_server_time;
+    out->resize.width = (ushort16)width;
+    out->resize.height = (ushort16)height;
+    return TRUE;
+}
+
+// Raw events reach every client selecting them, drop them without the lock
+b8 translate_relative_motion(PlatformHandler *platform_handler, f32 dx, f32 dy, uint32 time, LalEvent *out)
+{
+    if(!platform_handler->pointer_lock_active || (dx == 0.0f && dy == 0.0f))
+        return FALSE;
+
+    set_event_time(platform_handler, out, time);
+    out->type = LAL_EVENT_RELATIVE_MOTION;
+    out->relative_motion.dx = dx;
+    out->relative_motion.dy = dy;
+    return TRUE;
+}
+
+b8 translate_touch(PlatformHandler *platform_handler, LalEventType type, uint32 id,
+        sshort16 x, sshort16 y, uint32 time, LalEvent *out)
+{
+    if(!(platform_handler->input_features & INPUT_FEATURE_TOUCH))
+        return FALSE;
+
+    set_event_time(platform_handler, out, time);
+    out->type = type;
+    out->touch.id = id;
+    out->touch.x = x;
+    out->touch.y = y;
+    return TRUE;
+}
+
+b8 translate_focus(PlatformHandler *platform_handler, b8 focused, LalEvent *out)
+{
+    out->type = LAL_EVENT_FOCUS;
+    out->time = platform_handler->last_server_time;
+    out->focus.focused = focused;
+    return TRUE;
+}
+
+b8 translate_simple_event(PlatformHandler *platform_handler, LalEventType type, LalEvent *out)
+{
+    out->type = type;
+    out->time = platform_handler->last_server_time;
+    return TRUE;
+}
+
+// Translates one Xlib event, returns TRUE when it produced a LAL event.
+// Map and visibility changes only update the window state.
+b8 translate_xlib_event(PlatformHandler *platform_handler, Display *display, ulong32 delete_msg,
+        XEvent *event, LalEvent *out)
+{
+	// Variables to hold info about key pressed
+	char str[25] = {0};
+	KeySym keysym = 0;
+
+	// For key repeat detection
+	XEvent next_event;
+
+	switch(event->type)
+	{
+		case MapNotify:
+			platform_handler->mapped = TRUE;
+			return FALSE;
+		case UnmapNotify:
+			platform_handler->mapped = FALSE;
+			return FALSE;
+		case VisibilityNotify:
+			platform_handler->obscured = event->xvisibility.state == VisibilityFullyObscured;
+			return FALSE;
+		case FocusIn:
+		case FocusOut:
+			return translate_focus(platform_handler, event->type == FocusIn, out);
+		case ConfigureNotify:
+			track_window_position(platform_handler, event->xconfigure.x, event->xconfigure.y,
+				event->xconfigure.send_event);
+			return translate_resize(platform_handler, (uint32)event->xconfigure.width,
+				(uint32)event->xconfigure.height, out);
+		case Expose:
+			// Only react to the last one of a series
+			if(event->xexpose.count != 0)
+				return FALSE;
+			return translate_simple_event(platform_handler, LAL_EVENT_EXPOSE, out);
+		case ClientMessage:
+			if(event->xclient.data.l[0] != (long)delete_msg)
+				return FALSE;
+			return translate_simple_event(platform_handler, LAL_EVENT_CLOSE, out);
+		case GenericEvent:
+			return translate_xi_event(platform_handler, display, &event->xcookie, out);
+		case SelectionNotify:
+			handle_selection_notify(platform_handler, event->xselection.selection, event->xselection.property);
+			return FALSE;
+		case SelectionRequest:
+			handle_selection_request(platform_handler, event->xselectionrequest.requestor,
+				event->xselectionrequest.selection, event->xselectionrequest.target,
+				event->xselectionrequest.property, (uint32)event->xselectionrequest.time);
+			return FALSE;
+		case SelectionClear:
+			handle_selection_clear(platform_handler, event->xselectionclear.selection);
+			return FALSE;
+		case PropertyNotify:
+			handle_property_notify(platform_handler, event->xproperty.window, event->xproperty.atom,
+				event->xproperty.state == PropertyDelete);
+			return FALSE;
+		case DestroyNotify:
+			handle_destroy_notify(platform_handler, event->xdestroywindow.window);
+			return FALSE;
+		case KeyPress:
+		case KeyRelease:
+			if(platform_handler->raw_keyboard)
+				return FALSE;
+
+			// Fold a release + press pair into a single repeated press
+			if(event->type == KeyRelease && is_xlib_key_repeat(display, event, &next_event))
+				*event = next_event;
+
+			XLookupString(&event->xkey, str, 25, &keysym, NULL);
+			return translate_key(platform_handler, translate_keycode(keysym), event->type == KeyPress,
+				(uint32)event->xkey.time, out);
+		case ButtonPress:
+		case ButtonRelease:
+			return translate_button(platform_handler, event->xbutton.button, event->type == ButtonPress,
+				(sshort16)event->xbutton.x, (sshort16)event->xbutton.y, (uint32)event->xbutton.time, out);
+		case MotionNotify:
+			return translate_motion(platform_handler, (sshort16)event->xmotion.x, (sshort16)event->xmotion.y,
+				(uint32)event->xmotion.time, out);
+		default:
+			handle_monitor_event(platform_handler, (uint32)event->type);
+			return FALSE;
+	}
+}
+
+static void draw_window(PlatformHandler *platform_handler)
+{
+    WindowX11GL *gl_window;
+    WindowXCBGL *xcb_window;
+
+    // The render thread owns the context and redraws every frame anyway
+    if(platform_handler->render_thread != NULL)
+        return;
+
+    switch(platform_handler->backend)
     {
-        printf("ERROR: Failed to create window.\n");
-        XCloseDisplay(window->display);
-        return WINDOW_ERROR;
+        case WINDOW_BACKEND_GL_XLIB:
+            gl_window = (WindowX11GL *)platform_handler->window;
+            lal_gl.glViewport(0, 0, (GLsizei)platform_handler->width, (GLsizei)platform_handler->height);
+            lal_gl.glClearColor(0.8f, 0.5f, 0.5f, 1.0f);
+            lal_gl.glClear(GL_COLOR_BUFFER_BIT);
+            lal_capture_frame(platform_handler, platform_handler->width, platform_handler->height);
+            lal_gl.glXSwapBuffers(gl_window->display, gl_window->id);
+            break;
+        case WINDOW_BACKEND_XCB:
+            xcb_window = (WindowXCBGL *)platform_handler->window;
+            lal_gl.glClearColor(0.3f, 0.9f, 0.5f, 1.0f);
+            lal_gl.glClear(GL_COLOR_BUFFER_BIT);
+            lal_capture_frame(platform_handler, platform_handler->width, platform_handler->height);
+            lal_gl.glXSwapBuffers(xcb_window->display, xcb_window->glx_id);
+            break;
+        default:
+            break;
     }
+}
 
-    // Setup window delete message
-    window->delete_msg = XInternAtom(window->display, "WM_DELETE_WINDOW", FALSE);
-    XSetWMProtocols(window->display, window->id, &window->delete_msg, 1);
-
-    // Disable key repeat
-    XAutoRepeatOff(window->display);
-
-    // Initialize Input system
-    input_initialize();
-    
-    printf("Window created.\n");
-
-    // Create GLX OpenGL Context
-    glXCreateContextAttribsARBProc glXCreateContextAttribsARB = 0;
-	glXCreateContextAttribsARB = (glXCreateContextAttribsARBProc) glXGetProcAddressARB((const GLubyte *) "glXCreateContextAttribsARB");
-    
-    const char *glx_extensions = glXQueryExtensionsString(window->display, window->screen_id);
-
-    sint32 context_attributes[] = {
-        GLX_CONTEXT_MAJOR_VERSION_ARB, 3,
-		GLX_CONTEXT_MINOR_VERSION_ARB, 2,
-		GLX_CONTEXT_FLAGS_ARB, GLX_CONTEXT_FORWARD_COMPATIBLE_BIT_ARB,
-		None
-    };
-
-
-    window->context = 0;
-    if(!isExtensionSupported(glx_extensions, "GLX_ARB_create_context"))
-	    window->context = glXCreateNewContext(window->display, glx_fb_config, GLX_RGBA_TYPE, 0, TRUE);
-	else
-	    window->context = glXCreateContextAttribsARB(window->display, glx_fb_config, 0, TRUE, context_attributes);
-    
-    XSync(window->display, FALSE);
-
-    // Verify that context is a direct context
-    if(!glXIsDirect(window->display, window->context))
-        printf("Indirect GLX rendering context obtained.\n");
-    else
-        printf("Direct GLX rendering context obtained.\n");
-
-    // Setup window context
-    glXMakeCurrent(window->display, window->id, window->context);
-    
-    printf("GL Vendor: %s\n", glGetString(GL_VENDOR));
-    printf("GL Renderer: %s\n", glGetString(GL_RENDERER));
-    printf("GL Version: %s\n", glGetString(GL_VERSION));
-    printf("GL Shading Language: %s\n", glGetString(GL_SHADING_LANGUAGE_VERSION));
-        
-    return OK;
+// Applies a translated event to the platform and input state
+void dispatch_event(PlatformHandler *platform_handler, const LalEvent *event)
+{
+    switch(event->type)
+    {
+        case LAL_EVENT_KEY:
+            input_process_key((Keys)event->key.key, event->key.pressed);
+            input_update();
+            if(event->key.device != 0)
+                input_process_device_key(event->key.device, (Keys)event->key.key, event->key.pressed);
+            break;
+        case LAL_EVENT_BUTTON:
+            if(event->button.device != 0)
+                input_process_device_button(event->button.device, (Buttons)event->button.button, event->button.pressed);
+            break;
+        case LAL_EVENT_MOTION:
+            input_process_mouse_move(event->motion.x, event->motion.y);
+            if(event->motion.device != 0)
+                input_process_device_motion(event->motion.device, event->motion.x, event->motion.y);
+            break;
+        case LAL_EVENT_TOUCH_BEGIN:
+            input_process_touch(event->touch.id, TOUCH_PHASE_BEGAN, event->touch.x, event->touch.y);
+            break;
+        case LAL_EVENT_TOUCH_UPDATE:
+            input_process_touch(event->touch.id, TOUCH_PHASE_MOVED, event->touch.x, event->touch.y);
+            break;
+        case LAL_EVENT_TOUCH_END:
+            input_process_touch(event->touch.id, TOUCH_PHASE_ENDED, event->touch.x, event->touch.y);
+            break;
+        case LAL_EVENT_FOCUS:
+            platform_handler->focused = event->focus.focused;
+            update_pointer_lock(platform_handler);
+            break;
+        case LAL_EVENT_RESIZE:
+            platform_handler->width = event->resize.width;
+            platform_handler->height = event->resize.height;
+            move_pointer_barriers(platform_handler);
+            if(platform_handler->render_thread != NULL)
+                atomic_store(&((RenderThread *)platform_handler->render_thread)->size,
+                    (ullong64)event->resize.width << 32 | event->resize.height);
+            break;
+        case LAL_EVENT_EXPOSE:
+            draw_window(platform_handler);
+            break;
+        case LAL_EVENT_CLOSE:
+            platform_handler->running = FALSE;
+            break;
+        default:
+            break;
+    }
 }
 
+// Repeats only reach the event stream when asked for
+b8 is_event_delivered(PlatformHandler *platform_handler, const LalEvent *event)
+{
+    return event->type != LAL_EVENT_KEY || !event->key.repeat
+        || (platform_handler->input_features & INPUT_FEATURE_KEY_REPEAT);
+}
 
-// TODO: Add a better configuration for glx framebuffer in glx_fb_config_attribs
-b8 create_xcb_window(
-	PlatformHandler *platform_handler,
-	const char* window_title,
-	uint32 x,
-	uint32 y,
-	uint32 width,
-	uint32 height)
+uint32 poll_xlib_events(PlatformHandler *platform_handler, Display *display, ulong32 delete_msg,
+        LalEvent *events, uint32 capacity)
 {
-    platform_handler->window = malloc(sizeof(WindowX11GL));
-    WindowXCBGL *window = (WindowXCBGL *)platform_handler->window;
+    XEvent event;
+    uint32 count = 0;
+
+    sint32 timeout_ms = apply_idle_policy(platform_handler);
 
-    // Open Display
-    window->display = XOpenDisplay(NULL);
-    if(window->display == NULL)
+    if(capacity == 0)
+        return 0;
+
+    // Read the connection once, then drain what that read already queued
+    if(XPending(display) == 0 && timeout_ms != 0)
+    {
+        wait_for_connection(ConnectionNumber(display), timeout_ms);
+        XPending(display);
+    }
+    else
     {
-        printf("ERROR: Failed to open display.\n");
-        return WINDOW_ERROR;
+        dispatch_wait_sources();
     }
-    
-    // Setup Screen id
-    window->screen_id = DefaultScreen(window->display);
 
-    // Setup Event queue
-    XSetEventQueueOwner(window->display, XCBOwnsEventQueue);
+    while(count < capacity && XQLength(display) > 0)
+    {
+        XNextEvent(display, &event);
+
+        if(!translate_xlib_event(platform_handler, display, delete_msg, &event, &events[count]))
+            continue;
 
-    // Setup connection
-    window->xcb_connection = XGetXCBConnection(window->display);
+        dispatch_event(platform_handler, &events[count]);
+        if(is_event_delivered(platform_handler, &events[count]))
+            count++;
+    }
 
-    // Get XCB Screen
-    window->xcb_screen = NULL;
+    // A full buffer leaves it owed to the next call
+    if(count < capacity && flush_monitor_event(platform_handler, &events[count]))
+        dispatch_event(platform_handler, &events[count++]);
 
-    // Get data from the X server
-    const struct xcb_setup_t* setup = xcb_get_setup(window->xcb_connection);
+    count += poll_raw_keyboard_events(platform_handler, events + count, capacity - count);
 
-    // Loop through screens using an iterator
-    xcb_screen_iterator_t it = xcb_setup_roots_iterator(setup);
-    sint32 screen_p = 0;
-    for (sint32 s = screen_p; s > 0; s--)
-        xcb_screen_next(&it);
+    input_publish();
 
-    // Set screen
-    window->xcb_screen = it.data;
-    if(window->xcb_screen == NULL)
+    return count;
+}
+
+void process_xlib_events(PlatformHandler *platform_handler, Display *display, ulong32 delete_msg)
+{
+    XEvent event;
+    LalEvent lal_event;
+    LalEvent raw_events[16];
+
+    // Block like XNextEvent, but also wake for the wait sources, the raw
+    // keyboards and gamepads have no X event to ride on
+    if(XQLength(display) == 0 && XPending(display) == 0)
+    {
+        wait_for_connection(ConnectionNumber(display), -1);
+        XPending(display);
+    }
+
+    if(XQLength(display) > 0)
     {
-        printf("ERROR: Failed to get XCB Screen.\n");
-        return WINDOW_ERROR;
+        XNextEvent(display, &event);
+
+        if(translate_xlib_event(platform_handler, display, delete_msg, &event, &lal_event))
+            dispatch_event(platform_handler, &lal_event);
     }
 
-    // Setup GLX config attributes
-    int glx_fb_config_attribs[] = {
-        GLX_BUFFER_SIZE,   16,      // TODO: Check if sizes are the same
-        GLX_DOUBLEBUFFER,  TRUE,
-        GLX_SAMPLES,       0,
-        GLX_X_VISUAL_TYPE, GLX_TRUE_COLOR,
-        0,
-    };
-
-    // Get FB Config
-    sint32 glx_nfb_configs;
-    GLXFBConfig* glx_fb_configs = glXChooseFBConfig(window->display, window->x11_id, glx_fb_config_attribs, &glx_nfb_configs);
-    if(glx_nfb_configs == NULL)
+    // Once the burst of RandR notifications is drained
+    if(XQLength(display) == 0 && flush_monitor_event(platform_handler, &lal_event))
+        dispatch_event(platform_handler, &lal_event);
+
+    // The keys are dispatched as they are delivered, the buffer is scratch
+    while(poll_raw_keyboard_events(platform_handler, raw_events, 16) == 16)
+        ;
+
+    input_publish();
+}
+
+b8 initialize_window_threads()
+{
+    if(!XInitThreads())
     {
-        printf("ERROR: Failed to choose FB config.\n");
-        return CONTEXT_ERROR;
+        LAL_ERROR("Failed to initialize Xlib threads.");
+        return FAILED;
     }
 
-    // Set FB config
-    window->glx_fb_config  = glx_fb_configs[0];
-    XFree(glx_fb_configs);
-
-    // Get FB Config attributes
-    sint32 glx_visual_id;
-    //glXGetFBConfigAttrib(window->display, window->glx_fb_config, GLX_VISUAL_ID, &window->xcb_screen->root_visual);
-    glXGetFBConfigAttrib(window->display, window->glx_fb_config, GLX_VISUAL_ID, &glx_visual_id);
-
-
-    window->xcb_colormap = xcb_generate_id(window->xcb_connection);
-    //xcb_create_colormap(window->xcb_connection, XCB_COLORMAP_ALLOC_NONE, window->xcb_colormap, window->xcb_screen->root, window->xcb_screen->root_visual);
-    xcb_create_colormap(window->xcb_connection, XCB_COLORMAP_ALLOC_NONE, window->xcb_colormap, window->xcb_screen->root, glx_visual_id);
-    
-    // Setup events for window
-    uint32 value_mask = XCB_CW_BACK_PIXMAP | XCB_CW_EVENT_MASK | XCB_CW_COLORMAP;
-    uint32 value_list[] = {XCB_BACK_PIXMAP_NONE, XCB_EVENT_MASK_KEY_PRESS | XCB_EVENT_MASK_KEY_RELEASE
-        | XCB_EVENT_MASK_BUTTON_PRESS | XCB_EVENT_MASK_BUTTON_RELEASE| XCB_EVENT_MASK_POINTER_MOTION 
-        | XCB_EVENT_MASK_EXPOSURE | XCB_EVENT_MASK_STRUCTURE_NOTIFY, window->xcb_colormap};
-
-    // Crate XCB ID for window
-    window->xcb_id = xcb_generate_id(window->xcb_connection);
-
-    xcb_create_window(
-        window->xcb_connection, 
-        window->xcb_screen->root_depth, 
-        window->xcb_id, 
-        window->xcb_screen->root,
-        0,
-        0,
-        width,                              //window->xcb_screen->width_in_pixels, 
-        height,                             //window->xcb_screen->height_in_pixels, 
-        0,
-        XCB_WINDOW_CLASS_INPUT_OUTPUT,
-        glx_visual_id,
-        value_mask,
-        value_list);
-
-    // Map window
-    xcb_map_window(window->xcb_connection, window->xcb_id);
-
-    // Setup OpenGL configs
-    sint32 glx_context_attribs[] = {
-        GLX_CONTEXT_MAJOR_VERSION_ARB,   4,
-        GLX_CONTEXT_MINOR_VERSION_ARB,   6,
-        GLX_CONTEXT_FLAGS_ARB,           GLX_CONTEXT_FORWARD_COMPATIBLE_BIT_ARB,
-        GLX_CONTEXT_PROFILE_MASK_ARB,    GLX_CONTEXT_CORE_PROFILE_BIT_ARB,
-        GLX_CONTEXT_OPENGL_NO_ERROR_ARB, 1,
-        0,
-    };
-
-    window->glx_id = glXCreateWindow(window->display, window->glx_fb_config, window->xcb_id, NULL);
-    window->context =  glXCreateContextAttribsARB(window->display, window->glx_fb_config, NULL, 1, glx_context_attribs);
-
-    // Setup Window properties
-    xcb_change_property(
-        window->xcb_connection,
-        XCB_PROP_MODE_REPLACE,
-        window->xcb_id,
-        XCB_ATOM_WM_NAME,
-        XCB_ATOM_STRING,
-        8,                      // data should be viewed 8 bits at a time, TODO: Check if sizes are the same
-        strlen(window_title),
-        window_title);
-
-    // Setup messages for window
-    xcb_intern_atom_cookie_t wm_delete_cookie = xcb_intern_atom(
-        window->xcb_connection,
-        0,
-        strlen("WM_DELETE_WINDOW"),
-        "WM_DELETE_WINDOW");
-
-    xcb_intern_atom_cookie_t wm_protocols_cookie = xcb_intern_atom(
-        window->xcb_connection,
-        0,
-        strlen("WM_PROTOCOLS"),
-        "WM_PROTOCOLS");
-
-    xcb_intern_atom_reply_t *wm_delete_reply = xcb_intern_atom_reply(
-        window->xcb_connection,
-        wm_delete_cookie,
-        NULL);
-
-    xcb_intern_atom_reply_t *wm_protocols_reply = xcb_intern_atom_reply(
-        window->xcb_connection,
-        wm_protocols_cookie,
-        NULL);
-
-    // Setup window delete message
-    window->delete_msg = wm_delete_reply->atom;
-    window->wm_protocols = wm_protocols_reply->atom;
-
-    //xcb_map_window(window->xcb_connection, window->xcb_id);
-
-    // Disable key repeat
-    XAutoRepeatOff(window->display);
-
-    // Initialize Input system
-    input_initialize();
-    
-    // Make context current
-    glXMakeContextCurrent(window->display, window->glx_id, window->glx_id, window->context);
+    window_threads_initialized = TRUE;
 
     return OK;
 }
 
-void run_gl_xlib_window(PlatformHandler *platform_handler)
+static void *run_render_thread(void *arg)
+{
+    RenderThread *render_thread = (RenderThread *)arg;
+    ullong64 viewport_size = 0;
+
+    if(!lal_gl.glXMakeContextCurrent(render_thread->display, render_thread->drawable,
+            render_thread->drawable, render_thread->context))
+    {
+        LAL_ERROR("Failed to make context current on render thread.");
+        atomic_store(&render_thread->running, FALSE);
+        return NULL;
+    }
+
+    while(atomic_load(&render_thread->running))
+    {
+        ullong64 size = atomic_load(&render_thread->size);
+        uint32 width = (uint32)(size >> 32);
+        uint32 height = (uint32)(size & 0xFFFFFFFFu);
+
+        if(size != viewport_size)
+        {
+            lal_gl.glViewport(0, 0, (GLsizei)width, (GLsizei)height);
+            viewport_size = size;
+        }
+
+        render_thread->render(render_thread->user_data, width, height);
+        lal_capture_frame(render_thread->platform_handler, width, height);
+
+        // May block on vsync, only this thread waits for it
+        lal_gl.glXSwapBuffers(render_thread->display, render_thread->drawable);
+    }
+
+    // Release the context so the event thread can take it back
+    lal_gl.glXMakeContextCurrent(render_thread->display, None, None, NULL);
+
+    return NULL;
+}
+
+b8 start_render_thread(PlatformHandler *platform_handler, RenderCallback render, void *user_data)
 {
-	WindowX11GL *window = (WindowX11GL *)platform_handler->window;
-    
-    // Setup Input
-    XSelectInput(window->display, window->id, KeyPressMask | KeyReleaseMask 
-            | KeymapStateMask   | PointerMotionMask     | ButtonPressMask 
-            | ButtonReleaseMask | EnterWindowMask       | LeaveWindowMask
-            | ExposureMask      | StructureNotifyMask   | ButtonPressMask
-            | ButtonReleaseMask);
-
-    // Name window
-    XStoreName(window->display, window->id, "OpenGL Window Test");
-
-    // Show window
-    XClearWindow(window->display, window->id);
-    XMapRaised(window->display, window->id);
-
-    // Print window attributes
-    window->window_attribs;
-    XGetWindowAttributes(window->display, window->id, &window->window_attribs);
-    printf("Window Info:\n");
-    printf("\t%dx%d\n", window->window_attribs.width, window->window_attribs.height);
-
-    // Resize window
-    uint32 change_values = CWWidth | CWHeight;
-    XWindowChanges values;
-    values.width = 800;
-    values.height = 600;
-    XConfigureWindow(window->display, window->id, change_values, &values);
-
-    platform_handler->running = TRUE;
+    WindowX11GL *gl_window;
+    WindowXCBGL *xcb_window;
+    RenderThread *render_thread;
+
+    if(!window_threads_initialized)
+    {
+        LAL_ERROR("initialize_window_threads must be called before creating the window.");
+        return FAILED;
+    }
+
+    if(platform_handler->render_thread != NULL || render == NULL)
+        return FAILED;
+
+    render_thread = lal_allocate(sizeof(RenderThread));
+    if(render_thread == NULL)
+        return FAILED;
+
+    switch(platform_handler->backend)
+    {
+        case WINDOW_BACKEND_GL_XLIB:
+            gl_window = (WindowX11GL *)platform_handler->window;
+            render_thread->display = gl_window->display;
+            render_thread->drawable = gl_window->id;
+            render_thread->context = gl_window->context;
+            break;
+        case WINDOW_BACKEND_XCB:
+            xcb_window = (WindowXCBGL *)platform_handler->window;
+            render_thread->display = xcb_window->display;
+            render_thread->drawable = xcb_window->glx_id;
+            render_thread->context = xcb_window->context;
+            break;
+        default:
+            // No GL context to hand over
+            lal_free(render_thread, sizeof(RenderThread));
+            return CONTEXT_ERROR;
+    }
+
+    render_thread->platform_handler = platform_handler;
+    render_thread->render = render;
+    render_thread->user_data = user_data;
+    atomic_init(&render_thread->size, (ullong64)platform_handler->width << 32 | platform_handler->height);
+    atomic_init(&render_thread->running, TRUE);
+
+    // A context can only be current on one thread
+    lal_gl.glXMakeContextCurrent(render_thread->display, None, None, NULL);
+
+    if(lal_gl.glXSwapIntervalEXT != NULL)
+        lal_gl.glXSwapIntervalEXT(render_thread->display, render_thread->drawable, 1);
+
+    if(pthread_create(&render_thread->thread, NULL, run_render_thread, render_thread) != 0)
+    {
+        LAL_ERROR("Failed to start render thread.");
+        lal_gl.glXMakeContextCurrent(render_thread->display, render_thread->drawable,
+            render_thread->drawable, render_thread->context);
+        lal_free(render_thread, sizeof(RenderThread));
+        return FAILED;
+    }
+
+    platform_handler->render_thread = render_thread;
+
+    return OK;
 }
 
-void run_xcb_window(PlatformHandler *platform_handler)
+void stop_render_thread(PlatformHandler *platform_handler)
 {
-    WindowXCBGL *window = (WindowXCBGL *)platform_handler->window;
+    RenderThread *render_thread = (RenderThread *)platform_handler->render_thread;
+    if(render_thread == NULL)
+        return;
+
+    atomic_store(&render_thread->running, FALSE);
+    pthread_join(render_thread->thread, NULL);
 
-    platform_handler->running = TRUE;
+    lal_gl.glXMakeContextCurrent(render_thread->display, render_thread->drawable,
+        render_thread->drawable, render_thread->context);
+
+    lal_free(render_thread, sizeof(RenderThread));
+    platform_handler->render_thread = NULL;
 }
 
-// TODO: Fix XCB window shutdown -> error in glXDestroyWindow
-void shutdown_xcb_window(PlatformHandler *platform_handler)
+void set_input_features(PlatformHandler *platform_handler, uint32 features)
 {
-    WindowXCBGL *window = (WindowXCBGL *)platform_handler->window;
+    WindowX11 *simple_window;
+    WindowX11GL *gl_window;
+    WindowXCBGL *xcb_window;
+    uint32 xcb_mask;
+    uint32 changed = platform_handler->input_features ^ features;
 
-    // Enable key repeat
-	XAutoRepeatOn(window->display);
+    if(changed == 0)
+        return;
 
-    xcb_destroy_window(window->xcb_connection, window->xcb_id);
-    xcb_free_colormap(window->xcb_connection, window->xcb_colormap);
+    platform_handler->input_features = features;
 
-    glXDestroyWindow(window->display,  window->glx_id);
-    glXDestroyContext(window->display, window->context);
+    // Touch and per-device input go through XInput 2, per-device input
+    // also follows the keyboard and mouse features
+    if((changed & (INPUT_FEATURE_TOUCH | INPUT_FEATURE_PER_DEVICE)) || (features & INPUT_FEATURE_PER_DEVICE))
+        select_xi_events(platform_handler);
 
-    XCloseDisplay(window->display);
+    switch(platform_handler->backend)
+    {
+        case WINDOW_BACKEND_SIMPLE:
+            simple_window = (WindowX11 *)platform_handler->window;
+            XSelectInput(simple_window->display, simple_window->id, (long)event_mask_for(platform_handler));
+            XFlush(simple_window->display);
+            break;
+        case WINDOW_BACKEND_GL_XLIB:
+            gl_window = (WindowX11GL *)platform_handler->window;
+            XSelectInput(gl_window->display, gl_window->id, (long)event_mask_for(platform_handler));
+            XFlush(gl_window->display);
+            break;
+        case WINDOW_BACKEND_XCB:
+            xcb_window = (WindowXCBGL *)platform_handler->window;
+            xcb_mask = (uint32)event_mask_for(platform_handler);
+            xcb_change_window_attributes(xcb_window->xcb_connection, xcb_window->xcb_id, XCB_CW_EVENT_MASK, &xcb_mask);
+            xcb_flush(xcb_window->xcb_connection);
+            break;
+        default:
+            break;
+    }
 }
 
-void shutdown_simple_window(PlatformHandler *platform_handler)
+uint32 get_input_features(PlatformHandler *platform_handler)
 {
-	WindowX11 *window = (WindowX11 *)platform_handler->window;
-	
-	// Enable key repeat
-	XAutoRepeatOn(window->display);
-	
-	XCloseDisplay(window->display);
-	
-	if(platform_handler->window != NULL)
-		free(window);
+    return platform_handler->input_features;
 }
 
-void shutdown_gl_xlib_window(PlatformHandler *platform_handler)
+void set_idle_policy(PlatformHandler *platform_handler, WindowActivity activity, IdlePolicyMode mode, uint32 rate_hz)
 {
-    WindowX11GL *window = (WindowX11GL *)platform_handler->window;
+    if(activity >= WINDOW_ACTIVITY_COUNT)
+        return;
 
-    // Enable key repeat
-    XAutoRepeatOn(window->display);
+    platform_handler->idle_policies[activity].mode = mode;
+    platform_handler->idle_policies[activity].rate_hz = rate_hz;
+}
 
-    glXDestroyContext(window->display, window->context);
-    glXDestroyWindow(window->display, window->id);
-    
-    if(platform_handler->window != NULL)
-        free(window);
+WindowActivity get_window_activity(PlatformHandler *platform_handler)
+{
+    if(!platform_handler->mapped)
+        return WINDOW_UNMAPPED;
+
+    if(platform_handler->obscured)
+        return WINDOW_OBSCURED;
+
+    if(!platform_handler->focused)
+        return WINDOW_UNFOCUSED;
+
+    return WINDOW_ACTIVE;
 }
 
-void process_gl_xlib_events(PlatformHandler *platform_handler)
+void record_x_error(PlatformHandler *platform_handler, const WindowXError *error)
 {
-	WindowX11GL *window = (WindowX11GL *)platform_handler->window;
-	
-	// Variable to read events
-	XEvent event;
+    platform_handler->x_error_count++;
+    platform_handler->last_x_error = *error;
 
-	// Variables to hold info about key pressed
-	int len;
-	char str[25] = {0};
-	KeySym keysym = 0;
-	slong32 msg;
+    LAL_ERROR("X error %u on request %u.%u, resource 0x%x, serial %lu.",
+        error->error_code, error->request_code, error->minor_code, error->resource_id, error->serial);
 
-	// Window loop
-	b8 pressed;
-	Keys key;
-	
-	// For key repeat detection
-	XEvent next_event;
-    
-	XNextEvent(window->display, &event);
+    if(platform_handler->x_error_callback != NULL)
+        platform_handler->x_error_callback(platform_handler->x_error_user_data, error);
+}
 
-	switch(event.type)
-	{
-		case ClientMessage:
-			msg = (long)window->delete_msg;
-			if(event.xclient.data.l[0] == msg)
-				platform_handler->running = FALSE;
-			break;
-		case KeyPress:
-		case KeyRelease:
-			len = XLookupString(&event.xkey, str, 25, &keysym, NULL);
-			pressed = event.type == KeyPress;
-			key = translate_keycode(keysym);
-			input_process_key(key, pressed);
-			input_update();
-			break;
-        case Expose:
-            XGetWindowAttributes(window->display, window->id, &window->window_attribs);
-            glViewport(0, 0, window->window_attribs.width, window->window_attribs.height);
-            glClearColor(0.8f, 0.5f, 0.5f, 1.0f);
-            glClear(GL_COLOR_BUFFER_BIT);
-            glXSwapBuffers(window->display, window->id);
-            break;
-		default:
-			break;
-	}
+void record_xcb_error(PlatformHandler *platform_handler, const xcb_generic_error_t *xcb_error)
+{
+    WindowXError error;
+    error.serial = xcb_error->full_sequence;
+    error.resource_id = xcb_error->resource_id;
+    error.error_code = xcb_error->error_code;
+    error.request_code = xcb_error->major_code;
+    error.minor_code = xcb_error->minor_code;
+
+    record_x_error(platform_handler, &error);
 }
 
-// TODO: Fix closing event when clicking on X button
-void process_xcb_events(PlatformHandler *platform_handler)
+// Replaces the default handler, which exits on the first error
+static int handle_xlib_error(Display *display, XErrorEvent *event)
 {
-    WindowXCBGL *window = (WindowXCBGL *)platform_handler->window;
+    for(uint32 i = 0; i < LAL_MAX_ERROR_DISPLAYS; i++)
+    {
+        if(error_displays[i].display != display)
+            continue;
+
+        WindowXError error;
+        error.serial = event->serial;
+        error.resource_id = (uint32)event->resourceid;
+        error.error_code = event->error_code;
+        error.request_code = event->request_code;
+        error.minor_code = event->minor_code;
+
+        record_x_error(error_displays[i].platform_handler, &error);
+        return 0;
+    }
 
-    // Variables to handle event
-    xcb_generic_event_t *event = xcb_poll_for_event(window->xcb_connection);
-    xcb_client_message_event_t *client_msg;
+    // Not a window connection, leave it to whoever handled it before
+    if(previous_error_handler != NULL)
+        return previous_error_handler(display, event);
 
-    // Variables to handle key press translation
-    xcb_key_press_event_t *kb_event;
-    xcb_keycode_t code;
-    KeySym keysym = 0;
+    return 0;
+}
 
-    // Variables to handle key press for LAL library
-	b8 pressed;
-	Keys key;
+void register_x_error_display(PlatformHandler *platform_handler, Display *display)
+{
+    if(!error_handler_installed)
+    {
+        previous_error_handler = XSetErrorHandler(handle_xlib_error);
+        error_handler_installed = TRUE;
+    }
 
-    if(event != NULL)
+    for(uint32 i = 0; i < LAL_MAX_ERROR_DISPLAYS; i++)
     {
-        switch(event->response_type & ~0x80)
+        if(error_displays[i].display == NULL)
         {
-            case XCB_CLIENT_MESSAGE:
-                client_msg = (xcb_client_message_event_t *)event;
-                if(client_msg->data.data32[0] == window->delete_msg)
-                    platform_handler->running = FALSE;
-                break;
-            case XCB_KEY_PRESS:
-            case XCB_KEY_RELEASE:
-                kb_event = (xcb_key_press_event_t*)event;
-                pressed = event->response_type == XCB_KEY_PRESS;
-                code = kb_event->detail;
-                keysym = XkbKeycodeToKeysym(window->display, (KeyCode)code, 0, 0);
-                key = translate_keycode(keysym);
-                input_process_key(key, pressed);
-                input_update();
-                break;
-            case Expose:
-                //XGetWindowAttributes(window->display, window->x11_id, &window->window_attribs);
-                glClearColor(0.3f, 0.9f, 0.5f, 1.0f);
-                glClear(GL_COLOR_BUFFER_BIT);
-                glXSwapBuffers(window->display, window->glx_id);
-                break;
-            default:
-                break;
+            error_displays[i].display = display;
+            error_displays[i].platform_handler = platform_handler;
+            return;
         }
     }
 
-    free(event);
-    //printf("Deleted event.\n");
+    LAL_WARN("Too many windows, X errors of this one are not tracked.");
 }
 
-void process_simple_window_events(PlatformHandler *platform_handler)
+void unregister_x_error_display(Display *display)
 {
-	WindowX11 *window = (WindowX11 *)platform_handler->window;
+    for(uint32 i = 0; i < LAL_MAX_ERROR_DISPLAYS; i++)
+    {
+        if(error_displays[i].display == display)
+        {
+            error_displays[i].display = NULL;
+            error_displays[i].platform_handler = NULL;
+        }
+    }
+}
 
-	// Variable to read events
-	XEvent event;
+void set_x_error_callback(PlatformHandler *platform_handler, WindowErrorCallback callback, void *user_data)
+{
+    platform_handler->x_error_callback = callback;
+    platform_handler->x_error_user_data = user_data;
+}
 
-	// Variables to hold info about key pressed
-	int len;
-	char str[25] = {0};
-	KeySym keysym = 0;
-	slong32 msg;
+ullong64 get_x_error_count(PlatformHandler *platform_handler)
+{
+    return platform_handler->x_error_count;
+}
 
-	// Window loop
-	b8 pressed;
-	Keys key;
-	
-	// For key repeat detection
-	XEvent next_event;
+b8 check_x_errors(PlatformHandler *platform_handler)
+{
+    WindowX11 *simple_window;
+    WindowX11GL *gl_window;
+
+    switch(platform_handler->backend)
+    {
+        case WINDOW_BACKEND_SIMPLE:
+            simple_window = (WindowX11 *)platform_handler->window;
+            XSync(simple_window->display, False);
+            break;
+        case WINDOW_BACKEND_GL_XLIB:
+            gl_window = (WindowX11GL *)platform_handler->window;
+            XSync(gl_window->display, False);
+            break;
+        case WINDOW_BACKEND_XCB:
+#if LAL_HAS_BACKEND(LAL_BACKEND_XCB)
+            sync_xcb_errors(platform_handler);
+#endif
+            break;
+        default:
+            break;
+    }
 
-	XNextEvent(window->display, &event);
+    b8 result = platform_handler->x_error_count == platform_handler->x_error_checked ? OK : WINDOW_ERROR;
+    platform_handler->x_error_checked = platform_handler->x_error_count;
 
-	switch(event.type)
-	{
-		case ClientMessage:
-			msg = (long)window->delete_msg;
-			if(event.xclient.data.l[0] == msg)
-				platform_handler->running = FALSE;
-			break;
-		case KeyPress:
-		case KeyRelease:
-				len = XLookupString(&event.xkey, str, 25, &keysym, NULL);
-				pressed = event.type == KeyPress;
-				key = translate_keycode(keysym);
-				input_process_key(key, pressed);
-				input_update();
-				break;
-		default:
-			break;
-	}
+    return result;
 }
 
 b8 is_platform_running(PlatformHandler *platform_handler)
@@ -0,0 +1,313 @@
+#include "lal_defines.h"
+#include "lal_error_list.h"
+#include "lal/lal_window.h"
+#include "lal/lal_input.h"
+#include "lal/lal_gl.h"
+#include "lal/lal_capture.h"
+#include "lal/lal_memory.h"
+#include "lal/lal_event.h"
+#include "lal/lal_log.h"
+#include "lal_window_internal.h"
+
+#if LPLATFORM_LINUX
+
+// Releases what a failed create_gl_xlib_window got so far
+static b8 fail_gl_xlib_window(PlatformHandler *platform_handler, b8 error)
+{
+    WindowX11GL *window = (WindowX11GL *)platform_handler->window;
+
+    if(window->display != NULL)
+    {
+        unregister_x_error_display(window->display);
+        XCloseDisplay(window->display);
+    }
+
+    lal_free(window, sizeof(WindowX11GL));
+    platform_handler->window = NULL;
+
+    return error;
+}
+
+b8 create_gl_xlib_window(
+		PlatformHandler *platform_handler,
+		const char* window_title,
+		uint32 x,
+		uint32 y,
+		uint32 width,
+		uint32 height)
+{
+    initialize_platform_handler(platform_handler, WINDOW_BACKEND_GL_XLIB, width, height);
+
+    platform_handler->window = lal_allocate(sizeof(WindowX11GL));
+    if(platform_handler->window == NULL)
+        return WINDOW_ERROR;
+
+    WindowX11GL *window = (WindowX11GL *)platform_handler->window;
+
+    // Open Display
+    window->display = XOpenDisplay(NULL);
+    if(window->display == NULL)
+    {
+        LAL_ERROR("Failed to open display.");
+        return fail_gl_xlib_window(platform_handler, WINDOW_ERROR);
+    }
+
+    register_x_error_display(platform_handler, window->display);
+
+    // Resolve GL entry points, only done once per process
+    if(lal_gl_load() != OK)
+    {
+        return fail_gl_xlib_window(platform_handler, CONTEXT_ERROR);
+    }
+
+    // Initialize Screen
+    window->screen = DefaultScreenOfDisplay(window->display);
+    window->screen_id = DefaultScreen(window->display);
+    
+    LAL_DEBUG("Finding GL versions...");
+    sint32 major_version = 0;
+    sint32 minor_version = 0;
+
+    // Get GL versions
+    glXQueryVersion(window->display, &major_version, &minor_version);
+    if(major_version <= 1 && minor_version < 2)
+    {
+        LAL_ERROR("GLX 1.2 or greater is required.");
+        return fail_gl_xlib_window(platform_handler, CONTEXT_ERROR);
+    }
+
+    LAL_DEBUG("GLX version: %d.%d", major_version, minor_version);
+
+    sint32 glx_attribs[] = {
+        GLX_X_RENDERABLE,   True,
+		GLX_DRAWABLE_TYPE,  GLX_WINDOW_BIT,
+		GLX_RENDER_TYPE,    GLX_RGBA_BIT,
+		GLX_X_VISUAL_TYPE,  GLX_TRUE_COLOR,
+		GLX_RED_SIZE,       8,
+		GLX_GREEN_SIZE,     8,
+		GLX_BLUE_SIZE,      8,
+		GLX_ALPHA_SIZE,     8,
+		GLX_DEPTH_SIZE,     24,
+		GLX_STENCIL_SIZE,   8,
+		GLX_DOUBLEBUFFER,   True,
+		None
+    };
+
+    // Get framebuffer info
+    sint32 fb_count;
+    GLXFBConfig *fbc = glXChooseFBConfig(window->display, window->screen_id, glx_attribs, &fb_count);
+    if(fbc == NULL)
+    {
+        LAL_ERROR("Failed to retrieve framebuffer.");
+        return fail_gl_xlib_window(platform_handler, CONTEXT_ERROR);
+    }
+    
+    LAL_DEBUG("Getting best XVisualInfo.");
+    sint32 best_fbc = -1;
+    sint32 worst_fbc = -1;
+    sint32 best_num_samples = -1;
+    sint32 worst_num_samples = 999;
+    for(int i = 0; i < fb_count; i++)
+    {
+		XVisualInfo *temp_vi = glXGetVisualFromFBConfig(window->display, fbc[i]);
+		if(temp_vi != 0)
+        {
+			int samples_buf;
+            int samples;
+
+            glXGetFBConfigAttrib(window->display, fbc[i], GLX_SAMPLE_BUFFERS, &samples_buf);
+			glXGetFBConfigAttrib(window->display, fbc[i], GLX_SAMPLES       , &samples);
+
+			if(best_fbc < 0 || (samples_buf && samples > best_num_samples))
+            {
+				best_fbc = i;
+				best_num_samples = samples;
+			}
+
+			if(worst_fbc < 0 || !samples_buf || samples < worst_num_samples)
+				worst_fbc = i;
+
+			worst_num_samples = samples;
+		}
+
+		XFree(temp_vi);
+	}
+
+    LAL_DEBUG("Best visual info index: %d", best_fbc);
+    GLXFBConfig glx_fb_config = fbc[best_fbc];
+    XFree(fbc);
+    LAL_DEBUG("Context initialized.");
+
+    // Get visual from FB config
+    XVisualInfo *visual = glXGetVisualFromFBConfig(window->display, glx_fb_config);
+    if(visual == NULL)
+    {
+        LAL_ERROR("Failed to get visual from FB config.");
+        return fail_gl_xlib_window(platform_handler, CONTEXT_ERROR);
+    }
+
+    if(window->screen_id != visual->screen)
+    {
+        LAL_ERROR("screen_id(%d) does not match visual->screen(%d)", window->screen_id, visual->screen);
+        XFree(visual);
+        return fail_gl_xlib_window(platform_handler, CONTEXT_ERROR);
+    }
+
+    // Set window attributes - color, pixel, etc.
+    XSetWindowAttributes window_attribs;
+    window_attribs.border_pixel = BlackPixel(window->display, window->screen_id);
+    window_attribs.background_pixel = WhitePixel(window->display, window->screen_id);
+    window_attribs.override_redirect = TRUE;
+    window->colormap = XCreateColormap(window->display,
+            RootWindow(window->display, window->screen_id), visual->visual, AllocNone);
+    window_attribs.colormap = window->colormap;
+    window_attribs.event_mask = ExposureMask;
+
+    // Create window
+    window->id = XCreateWindow(
+        window->display,
+        RootWindow(window->display, window->screen_id),
+        0,
+        0,
+        width,
+        height, 
+        0,
+        visual->depth,
+        InputOutput,
+        visual->visual,
+        CWBackPixel | CWColormap | CWBorderPixel | CWEventMask,
+        &window_attribs);
+
+    XFree(visual);
+
+    if(window->id == 0)
+    {
+        LAL_ERROR("Failed to create window.");
+        return fail_gl_xlib_window(platform_handler, WINDOW_ERROR);
+    }
+
+    // Setup window delete message
+    window->delete_msg = XInternAtom(window->display, "WM_DELETE_WINDOW", FALSE);
+    XSetWMProtocols(window->display, window->id, &window->delete_msg, 1);
+
+    // Report auto-repeat as repeated presses for this client only
+    enable_detectable_auto_repeat(window->display);
+
+    LAL_DEBUG("Window created.");
+
+    // Create GLX OpenGL Context
+    const char *glx_extensions = glXQueryExtensionsString(window->display, window->screen_id);
+
+    sint32 context_attributes[] = {
+        GLX_CONTEXT_MAJOR_VERSION_ARB, 3,
+		GLX_CONTEXT_MINOR_VERSION_ARB, 2,
+		GLX_CONTEXT_FLAGS_ARB, GLX_CONTEXT_FORWARD_COMPATIBLE_BIT_ARB,
+		None
+    };
+
+    window->context = 0;
+    if(isExtensionSupported(glx_extensions, "GLX_ARB_create_context") != OK
+            || lal_gl.glXCreateContextAttribsARB == NULL)
+	    window->context = glXCreateNewContext(window->display, glx_fb_config, GLX_RGBA_TYPE, 0, TRUE);
+	else
+	    window->context = lal_gl.glXCreateContextAttribsARB(window->display, glx_fb_config, 0, TRUE, context_attributes);
+
+    // Protocol errors of the request arrive later through the error handler
+    if(window->context == NULL)
+    {
+        LAL_ERROR("Failed to create GLX context.");
+        return fail_gl_xlib_window(platform_handler, CONTEXT_ERROR);
+    }
+
+    // Initialize Input system, after the last failure path like the xcb backend
+    input_initialize();
+
+    // Monitor table, queried once here and then kept by RandR events
+    initialize_monitors(platform_handler);
+
+    // Verify that context is a direct context
+    if(!glXIsDirect(window->display, window->context))
+        LAL_INFO("Indirect GLX rendering context obtained.");
+    else
+        LAL_INFO("Direct GLX rendering context obtained.");
+
+    // Setup window context
+    glXMakeCurrent(window->display, window->id, window->context);
+    
+    LAL_INFO("GL Vendor: %s", lal_gl.glGetString(GL_VENDOR));
+    LAL_INFO("GL Renderer: %s", lal_gl.glGetString(GL_RENDERER));
+    LAL_INFO("GL Version: %s", lal_gl.glGetString(GL_VERSION));
+    LAL_INFO("GL Shading Language: %s", lal_gl.glGetString(GL_SHADING_LANGUAGE_VERSION));
+        
+    return OK;
+}
+
+void run_gl_xlib_window(PlatformHandler *platform_handler)
+{
+	WindowX11GL *window = (WindowX11GL *)platform_handler->window;
+    
+    // Setup Input
+    XSelectInput(window->display, window->id, (long)event_mask_for(platform_handler));
+
+    // Name window
+    XStoreName(window->display, window->id, "OpenGL Window Test");
+
+    // Show window
+    XClearWindow(window->display, window->id);
+    XMapRaised(window->display, window->id);
+
+    // Print window attributes
+    window->window_attribs;
+    XGetWindowAttributes(window->display, window->id, &window->window_attribs);
+    LAL_DEBUG("Window size: %dx%d", window->window_attribs.width, window->window_attribs.height);
+
+    // Resize window
+    uint32 change_values = CWWidth | CWHeight;
+    XWindowChanges values;
+    values.width = 800;
+    values.height = 600;
+    XConfigureWindow(window->display, window->id, change_values, &values);
+
+    platform_handler->running = TRUE;
+}
+
+void shutdown_gl_xlib_window(PlatformHandler *platform_handler)
+{
+    WindowX11GL *window = (WindowX11GL *)platform_handler->window;
+
+    stop_render_thread(platform_handler);
+    lal_capture_stop(platform_handler);
+    destroy_clipboard(platform_handler);
+    destroy_monitors(platform_handler);
+
+    // The window is a plain X window, not a GLXWindow. Unbind the context
+    // first, a current one is only flagged for deletion.
+    glXMakeCurrent(window->display, None, NULL);
+    glXDestroyContext(window->display, window->context);
+    XDestroyWindow(window->display, window->id);
+    XFreeColormap(window->display, window->colormap);
+
+    unregister_x_error_display(window->display);
+    XCloseDisplay(window->display);
+
+    input_shutdown();
+
+    lal_free(window, sizeof(WindowX11GL));
+    platform_handler->window = NULL;
+}
+
+void process_gl_xlib_events(PlatformHandler *platform_handler)
+{
+	WindowX11GL *window = (WindowX11GL *)platform_handler->window;
+
+	process_xlib_events(platform_handler, window->display, window->delete_msg);
+}
+
+uint32 poll_gl_xlib_events(PlatformHandler *platform_handler, LalEvent *events, uint32 capacity)
+{
+	WindowX11GL *window = (WindowX11GL *)platform_handler->window;
+
+	return poll_xlib_events(platform_handler, window->display, window->delete_msg, events, capacity);
+}
+
+#endif // LPLATFORM_LINUX
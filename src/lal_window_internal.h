@@ -0,0 +1,162 @@
+#ifndef LAL_WINDOW_INTERNAL_H
+#define LAL_WINDOW_INTERNAL_H
+
+// Shared between the window backends, not part of the public API
+
+#include "lal_defines.h"
+#include "lal/lal_window.h"
+#include "lal/lal_input.h"
+#include "lal/lal_event.h"
+#include "lal/lal_memory.h"
+
+#if LPLATFORM_LINUX
+
+#include <X11/X.h>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+
+#include <X11/Xlib-xcb.h>
+#include <X11/XKBlib.h>
+
+#include <GL/glx.h>
+#include <GL/glxext.h>
+
+typedef struct WindowX11
+{
+	Display *display;
+	ulong32 id;
+	Screen screen;
+	ulong32 delete_msg;
+} WindowX11;
+
+typedef struct WindowX11GL
+{
+	Display *display;
+	ulong32 id;
+	Screen *screen;
+    sint32 screen_id;
+	ulong32 delete_msg;
+    GLXContext context;
+    XWindowAttributes window_attribs;
+    ulong32 colormap;
+} WindowX11GL;
+
+// Events read ahead by check_x_errors, handed out by the next poll
+#define LAL_XCB_DEFERRED_EVENTS 64
+
+typedef struct WindowXCBGL
+{
+	Display *display;
+    ulong32 x11_id;
+    sint32 screen_id;
+	uint32 xcb_id;
+    xcb_connection_t *xcb_connection;
+    xcb_screen_t *xcb_screen;
+    uint32 delete_msg;
+	uint32 wm_protocols;
+    XWindowAttributes window_attribs;
+    GLXContext context;
+    ulong32 glx_id;
+    uint32 xcb_colormap;
+    GLXFBConfig glx_fb_config;
+    xcb_generic_event_t *deferred_events[LAL_XCB_DEFERRED_EVENTS];
+    uint32 deferred_head;
+    uint32 deferred_count;
+    LalFrameCheck frame_check;
+} WindowXCBGL;
+
+Keys translate_keycode(uint32 key);
+
+// Display and X window id of any backend
+Display *get_x_window(PlatformHandler *platform_handler, ulong32 *window);
+b8 isExtensionSupported(const char *extList, const char *extension);
+
+void initialize_platform_handler(PlatformHandler *platform_handler, WindowBackend backend,
+        uint32 width, uint32 height);
+void enable_detectable_auto_repeat(Display *display);
+ulong32 event_mask_for(PlatformHandler *platform_handler);
+
+// Routes Xlib errors of display to platform_handler, see check_x_errors
+void register_x_error_display(PlatformHandler *platform_handler, Display *display);
+void unregister_x_error_display(Display *display);
+void record_x_error(PlatformHandler *platform_handler, const WindowXError *error);
+void record_xcb_error(PlatformHandler *platform_handler, const xcb_generic_error_t *error);
+
+// Round-trip that moves pending XCB errors out of the event queue
+void sync_xcb_errors(PlatformHandler *platform_handler);
+
+// Idle policy, see set_idle_policy
+sint32 apply_idle_policy(PlatformHandler *platform_handler);
+// Waits for fd or any wait source, dispatching the ready sources
+void wait_for_connection(sint32 fd, sint32 timeout_ms);
+
+// Dispatches the ready wait sources without blocking
+void dispatch_wait_sources();
+
+// Backend independent parts of event translation
+b8 translate_key(PlatformHandler *platform_handler, Keys key, b8 pressed, uint32 time, LalEvent *out);
+b8 translate_button(PlatformHandler *platform_handler, uint32 x_button, b8 pressed,
+        sshort16 x, sshort16 y, uint32 time, LalEvent *out);
+b8 translate_motion(PlatformHandler *platform_handler, sshort16 x, sshort16 y, uint32 time, LalEvent *out);
+b8 translate_resize(PlatformHandler *platform_handler, uint32 width, uint32 height, LalEvent *out);
+b8 translate_relative_motion(PlatformHandler *platform_handler, f32 dx, f32 dy, uint32 time, LalEvent *out);
+b8 translate_touch(PlatformHandler *platform_handler, LalEventType type, uint32 id,
+        sshort16 x, sshort16 y, uint32 time, LalEvent *out);
+b8 translate_focus(PlatformHandler *platform_handler, b8 focused, LalEvent *out);
+b8 translate_simple_event(PlatformHandler *platform_handler, LalEventType type, LalEvent *out);
+b8 translate_xlib_event(PlatformHandler *platform_handler, Display *display, ulong32 delete_msg,
+        XEvent *event, LalEvent *out);
+
+// XInput 2 raw motion and touch, through Xlib cookies or straight from the XCB queue
+b8 translate_xi_event(PlatformHandler *platform_handler, Display *display, XGenericEventCookie *cookie,
+        LalEvent *out);
+b8 translate_xi_wire_event(PlatformHandler *platform_handler, const xcb_ge_generic_event_t *event, LalEvent *out);
+
+// Takes or drops the pointer lock to match the focus, see set_pointer_lock
+void update_pointer_lock(PlatformHandler *platform_handler);
+void move_pointer_barriers(PlatformHandler *platform_handler);
+
+// XInput 2 selections for INPUT_FEATURE_TOUCH and INPUT_FEATURE_PER_DEVICE
+void select_xi_events(PlatformHandler *platform_handler);
+
+// Selection transfers, see lal_clipboard.h. Called from event translation.
+void handle_selection_notify(PlatformHandler *platform_handler, ulong32 selection, ulong32 property);
+void handle_selection_request(PlatformHandler *platform_handler, ulong32 requestor, ulong32 selection,
+        ulong32 target, ulong32 property, uint32 time);
+void handle_selection_clear(PlatformHandler *platform_handler, ulong32 selection);
+void handle_property_notify(PlatformHandler *platform_handler, ulong32 window, ulong32 atom, b8 deleted);
+void handle_destroy_notify(PlatformHandler *platform_handler, ulong32 window);
+void destroy_clipboard(PlatformHandler *platform_handler);
+
+// RandR monitor cache, see lal_monitor.h
+void initialize_monitors(PlatformHandler *platform_handler);
+void destroy_monitors(PlatformHandler *platform_handler);
+void track_window_position(PlatformHandler *platform_handler, sint32 x, sint32 y, b8 synthetic);
+void handle_monitor_event(PlatformHandler *platform_handler, uint32 type);
+
+// Refreshes the table once after a batch of RandR notifications and
+// produces LAL_EVENT_MONITORS_CHANGED, FALSE when nothing changed
+b8 flush_monitor_event(PlatformHandler *platform_handler, LalEvent *out);
+
+// Current root window size, DisplayWidth/DisplayHeight miss RandR resizes
+void get_root_size(PlatformHandler *platform_handler, uint32 *width, uint32 *height);
+
+// Xinerama screen number of a table monitor, -1 when the orderings may differ
+sint32 get_xinerama_index(PlatformHandler *platform_handler, sint32 monitor);
+
+void dispatch_event(PlatformHandler *platform_handler, const LalEvent *event);
+b8 is_event_delivered(PlatformHandler *platform_handler, const LalEvent *event);
+
+// Shared poll loop of the simple and gl_xlib backends
+uint32 poll_xlib_events(PlatformHandler *platform_handler, Display *display, ulong32 delete_msg,
+        LalEvent *events, uint32 capacity);
+
+// Shared blocking loop of the simple and gl_xlib backends, one X event per call
+void process_xlib_events(PlatformHandler *platform_handler, Display *display, ulong32 delete_msg);
+
+// Delivers the keys read by lal_raw_keyboard, after the X events of a poll
+uint32 poll_raw_keyboard_events(PlatformHandler *platform_handler, LalEvent *events, uint32 capacity);
+
+#endif // LPLATFORM_LINUX
+
+#endif // LAL_WINDOW_INTERNAL_H
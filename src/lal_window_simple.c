@@ -0,0 +1,114 @@
+#include "lal_defines.h"
+#include "lal_error_list.h"
+#include "lal/lal_window.h"
+#include "lal/lal_input.h"
+#include "lal/lal_gl.h"
+#include "lal/lal_memory.h"
+#include "lal/lal_event.h"
+#include "lal/lal_log.h"
+#include "lal_window_internal.h"
+
+#if LPLATFORM_LINUX
+
+b8 create_simple_window(
+		PlatformHandler *platform_handler,
+		uint32 x,
+		uint32 y,
+		uint32 width,
+		uint32 height)
+{
+	initialize_platform_handler(platform_handler, WINDOW_BACKEND_SIMPLE, width, height);
+
+	// Create WindowX11
+	platform_handler->window = lal_allocate(sizeof(WindowX11));
+	if(platform_handler->window == NULL)
+		return WINDOW_ERROR;
+
+	WindowX11 *window = (WindowX11 *)platform_handler->window;
+	
+	// Open a connection to X server
+	window->display = XOpenDisplay(NULL);
+	if(window->display == NULL)
+	{
+		LAL_ERROR("Failed to open display.");
+		lal_free(window, sizeof(WindowX11));
+		platform_handler->window = NULL;
+		return WINDOW_ERROR;
+	}
+
+	register_x_error_display(platform_handler, window->display);
+
+	// Setup window config
+	window->id = XCreateSimpleWindow(
+			window->display,					// display
+			DefaultRootWindow(window->display),	// parent
+			x,									// x pos
+			y,									// y pos
+			width,								// width
+			height,								// height
+			0,									// border width
+			0,									// border
+			0);									// background
+
+	// Report events associated with specified event mask
+	XSelectInput(window->display, window->id, (long)event_mask_for(platform_handler));
+
+	// Map window by client application
+	XMapWindow(window->display, window->id);
+	
+	// Variable to hold the delete window message
+	window->delete_msg = XInternAtom(window->display, "WM_DELETE_WINDOW", 0);
+	XSetWMProtocols(window->display, window->id, &window->delete_msg, 1);
+
+	// Report auto-repeat as repeated presses for this client only
+	enable_detectable_auto_repeat(window->display);
+
+	// Initialize Input system
+	input_initialize();
+
+	// Monitor table, queried once here and then kept by RandR events
+	initialize_monitors(platform_handler);
+
+	// Set running to false
+	platform_handler->running = TRUE;
+
+	return OK;
+}
+
+void run_simple_window(PlatformHandler *platform_handler)
+{
+	platform_handler->running = TRUE;
+}
+
+void shutdown_simple_window(PlatformHandler *platform_handler)
+{
+	WindowX11 *window = (WindowX11 *)platform_handler->window;
+
+	destroy_clipboard(platform_handler);
+	destroy_monitors(platform_handler);
+	XDestroyWindow(window->display, window->id);
+
+	unregister_x_error_display(window->display);
+	XCloseDisplay(window->display);
+
+	input_shutdown();
+
+	lal_free(window, sizeof(WindowX11));
+	platform_handler->window = NULL;
+}
+
+void process_simple_window_events(PlatformHandler *platform_handler)
+{
+	WindowX11 *window = (WindowX11 *)platform_handler->window;
+
+	process_xlib_events(platform_handler, window->display, window->delete_msg);
+}
+
+uint32 poll_simple_window_events(PlatformHandler *platform_handler, LalEvent *events, uint32 capacity)
+{
+	WindowX11 *window = (WindowX11 *)platform_handler->window;
+
+	return poll_xlib_events(platform_handler, window->display, window->delete_msg, events, capacity);
+}
+
+#endif // LPLATFORM_LINUX
@@ -0,0 +1,507 @@
+#include "lal_defines.h"
+#include "lal_error_list.h"
+#include "lal/lal_window.h"
+#include "lal/lal_input.h"
+#include "lal/lal_gl.h"
+#include "lal/lal_capture.h"
+#include "lal/lal_memory.h"
+#include "lal/lal_event.h"
+#include "lal/lal_log.h"
+#include "lal_window_internal.h"
+
+#if LPLATFORM_LINUX
+
+#include <stdlib.h>
+#include <string.h>
+
+// Events translated per process_xcb_events call
+#define LAL_XCB_EVENT_BATCH 64
+
+#ifdef LAL_DEBUG_ZERO_ALLOC
+// Frames allowed to allocate before steady state is asserted
+#define LAL_DEBUG_ZERO_ALLOC_WARMUP 120
+#endif
+
+// Releases what a failed create_xcb_window got so far
+static b8 fail_xcb_window(PlatformHandler *platform_handler, b8 error)
+{
+    WindowXCBGL *window = (WindowXCBGL *)platform_handler->window;
+
+    if(window->display != NULL)
+    {
+        unregister_x_error_display(window->display);
+        XCloseDisplay(window->display);
+    }
+
+    lal_free(window, sizeof(WindowXCBGL));
+    platform_handler->window = NULL;
+
+    return error;
+}
+
+// TODO: Add a better configuration for glx framebuffer in glx_fb_config_attribs
+b8 create_xcb_window(
+	PlatformHandler *platform_handler,
+	const char* window_title,
+	uint32 x,
+	uint32 y,
+	uint32 width,
+	uint32 height)
+{
+    initialize_platform_handler(platform_handler, WINDOW_BACKEND_XCB, width, height);
+
+    platform_handler->window = lal_allocate(sizeof(WindowXCBGL));
+    if(platform_handler->window == NULL)
+        return WINDOW_ERROR;
+
+    WindowXCBGL *window = (WindowXCBGL *)platform_handler->window;
+    window->deferred_head = 0;
+    window->deferred_count = 0;
+    memset(&window->frame_check, 0, sizeof(LalFrameCheck));
+
+    // Open Display
+    window->display = XOpenDisplay(NULL);
+    if(window->display == NULL)
+    {
+        LAL_ERROR("Failed to open display.");
+        return fail_xcb_window(platform_handler, WINDOW_ERROR);
+    }
+
+    register_x_error_display(platform_handler, window->display);
+    
+    // Resolve GL entry points, only done once per process
+    if(lal_gl_load() != OK)
+    {
+        return fail_xcb_window(platform_handler, CONTEXT_ERROR);
+    }
+
+    // Setup Screen id
+    window->screen_id = DefaultScreen(window->display);
+
+    // Setup Event queue
+    XSetEventQueueOwner(window->display, XCBOwnsEventQueue);
+
+    // Setup connection
+    window->xcb_connection = XGetXCBConnection(window->display);
+
+    // Get XCB Screen
+    window->xcb_screen = NULL;
+
+    // Get data from the X server
+    const struct xcb_setup_t* setup = xcb_get_setup(window->xcb_connection);
+
+    // Loop through screens using an iterator
+    xcb_screen_iterator_t it = xcb_setup_roots_iterator(setup);
+    sint32 screen_p = 0;
+    for (sint32 s = screen_p; s > 0; s--)
+        xcb_screen_next(&it);
+
+    // Set screen
+    window->xcb_screen = it.data;
+    if(window->xcb_screen == NULL)
+    {
+        LAL_ERROR("Failed to get XCB Screen.");
+        return fail_xcb_window(platform_handler, WINDOW_ERROR);
+    }
+
+    // Setup GLX config attributes
+    int glx_fb_config_attribs[] = {
+        GLX_BUFFER_SIZE,   16,      // TODO: Check if sizes are the same
+        GLX_DOUBLEBUFFER,  TRUE,
+        GLX_SAMPLES,       0,
+        GLX_X_VISUAL_TYPE, GLX_TRUE_COLOR,
+        0,
+    };
+
+    // Get FB Config
+    sint32 glx_nfb_configs;
+    GLXFBConfig* glx_fb_configs = glXChooseFBConfig(window->display, window->x11_id, glx_fb_config_attribs, &glx_nfb_configs);
+    if(glx_nfb_configs == NULL)
+    {
+        LAL_ERROR("Failed to choose FB config.");
+        return fail_xcb_window(platform_handler, CONTEXT_ERROR);
+    }
+
+    // Set FB config
+    window->glx_fb_config  = glx_fb_configs[0];
+    XFree(glx_fb_configs);
+
+    // Get FB Config attributes
+    sint32 glx_visual_id;
+    //glXGetFBConfigAttrib(window->display, window->glx_fb_config, GLX_VISUAL_ID, &window->xcb_screen->root_visual);
+    glXGetFBConfigAttrib(window->display, window->glx_fb_config, GLX_VISUAL_ID, &glx_visual_id);
+
+    window->xcb_colormap = xcb_generate_id(window->xcb_connection);
+    //xcb_create_colormap(window->xcb_connection, XCB_COLORMAP_ALLOC_NONE, window->xcb_colormap, window->xcb_screen->root, window->xcb_screen->root_visual);
+    xcb_void_cookie_t colormap_cookie = xcb_create_colormap_checked(window->xcb_connection,
+        XCB_COLORMAP_ALLOC_NONE, window->xcb_colormap, window->xcb_screen->root, (xcb_visualid_t)glx_visual_id);
+    
+    // Setup events for window
+    uint32 value_mask = XCB_CW_BACK_PIXMAP | XCB_CW_EVENT_MASK | XCB_CW_COLORMAP;
+    uint32 value_list[] = {XCB_BACK_PIXMAP_NONE, (uint32)event_mask_for(platform_handler), window->xcb_colormap};
+
+    // Crate XCB ID for window
+    window->xcb_id = xcb_generate_id(window->xcb_connection);
+
+    xcb_void_cookie_t window_cookie = xcb_create_window_checked(
+        window->xcb_connection, 
+        window->xcb_screen->root_depth, 
+        window->xcb_id, 
+        window->xcb_screen->root,
+        0,
+        0,
+        width,                              //window->xcb_screen->width_in_pixels, 
+        height,                             //window->xcb_screen->height_in_pixels, 
+        0,
+        XCB_WINDOW_CLASS_INPUT_OUTPUT,
+        glx_visual_id,
+        value_mask,
+        value_list);
+
+    // Map window
+    xcb_map_window(window->xcb_connection, window->xcb_id);
+
+    // Setup OpenGL configs
+    sint32 glx_context_attribs[] = {
+        GLX_CONTEXT_MAJOR_VERSION_ARB,   4,
+        GLX_CONTEXT_MINOR_VERSION_ARB,   6,
+        GLX_CONTEXT_FLAGS_ARB,           GLX_CONTEXT_FORWARD_COMPATIBLE_BIT_ARB,
+        GLX_CONTEXT_PROFILE_MASK_ARB,    GLX_CONTEXT_CORE_PROFILE_BIT_ARB,
+        GLX_CONTEXT_OPENGL_NO_ERROR_ARB, 1,
+        0,
+    };
+
+    window->glx_id = glXCreateWindow(window->display, window->glx_fb_config, window->xcb_id, NULL);
+    if(lal_gl.glXCreateContextAttribsARB == NULL)
+    {
+        LAL_ERROR("glXCreateContextAttribsARB is not supported.");
+        return fail_xcb_window(platform_handler, CONTEXT_ERROR);
+    }
+    window->context = lal_gl.glXCreateContextAttribsARB(window->display, window->glx_fb_config, NULL, 1, glx_context_attribs);
+    if(window->context == NULL)
+    {
+        LAL_ERROR("Failed to create GLX context.");
+        return fail_xcb_window(platform_handler, CONTEXT_ERROR);
+    }
+
+    // Setup Window properties
+    xcb_change_property(
+        window->xcb_connection,
+        XCB_PROP_MODE_REPLACE,
+        window->xcb_id,
+        XCB_ATOM_WM_NAME,
+        XCB_ATOM_STRING,
+        8,                      // data should be viewed 8 bits at a time, TODO: Check if sizes are the same
+        strlen(window_title),
+        window_title);
+
+    // Setup messages for window
+    xcb_intern_atom_cookie_t wm_delete_cookie = xcb_intern_atom(
+        window->xcb_connection,
+        0,
+        strlen("WM_DELETE_WINDOW"),
+        "WM_DELETE_WINDOW");
+
+    xcb_intern_atom_cookie_t wm_protocols_cookie = xcb_intern_atom(
+        window->xcb_connection,
+        0,
+        strlen("WM_PROTOCOLS"),
+        "WM_PROTOCOLS");
+
+    xcb_intern_atom_reply_t *wm_delete_reply = xcb_intern_atom_reply(
+        window->xcb_connection,
+        wm_delete_cookie,
+        NULL);
+
+    xcb_intern_atom_reply_t *wm_protocols_reply = xcb_intern_atom_reply(
+        window->xcb_connection,
+        wm_protocols_cookie,
+        NULL);
+
+    // The atom replies above already waited for the server, checking the
+    // earlier requests costs no extra round-trip
+    xcb_generic_error_t *colormap_error = xcb_request_check(window->xcb_connection, colormap_cookie);
+    xcb_generic_error_t *window_error = xcb_request_check(window->xcb_connection, window_cookie);
+    if(colormap_error != NULL || window_error != NULL || wm_delete_reply == NULL || wm_protocols_reply == NULL)
+    {
+        if(colormap_error != NULL)
+            record_xcb_error(platform_handler, colormap_error);
+        if(window_error != NULL)
+            record_xcb_error(platform_handler, window_error);
+
+        free(colormap_error);
+        free(window_error);
+        free(wm_delete_reply);
+        free(wm_protocols_reply);
+        LAL_ERROR("Failed to create XCB window.");
+        return fail_xcb_window(platform_handler, WINDOW_ERROR);
+    }
+
+    // Setup window delete message
+    window->delete_msg = wm_delete_reply->atom;
+    window->wm_protocols = wm_protocols_reply->atom;
+    free(wm_delete_reply);
+    free(wm_protocols_reply);
+
+    //xcb_map_window(window->xcb_connection, window->xcb_id);
+
+    // Report auto-repeat as repeated presses for this client only
+    enable_detectable_auto_repeat(window->display);
+
+    // Initialize Input system
+    input_initialize();
+
+    // Monitor table, queried once here and then kept by RandR events
+    initialize_monitors(platform_handler);
+
+    // Make context current
+    lal_gl.glXMakeContextCurrent(window->display, window->glx_id, window->glx_id, window->context);
+
+    return OK;
+}
+
+void run_xcb_window(PlatformHandler *platform_handler)
+{
+    WindowXCBGL *window = (WindowXCBGL *)platform_handler->window;
+
+    platform_handler->running = TRUE;
+}
+
+static xcb_generic_event_t *take_deferred_event(WindowXCBGL *window)
+{
+    if(window->deferred_count == 0)
+        return NULL;
+
+    xcb_generic_event_t *event = window->deferred_events[window->deferred_head];
+    window->deferred_head = (window->deferred_head + 1) % LAL_XCB_DEFERRED_EVENTS;
+    window->deferred_count--;
+
+    return event;
+}
+
+void shutdown_xcb_window(PlatformHandler *platform_handler)
+{
+    WindowXCBGL *window = (WindowXCBGL *)platform_handler->window;
+    xcb_generic_event_t *event;
+
+    stop_render_thread(platform_handler);
+    lal_capture_stop(platform_handler);
+    destroy_clipboard(platform_handler);
+    destroy_monitors(platform_handler);
+
+    // A context that is still current is only flagged for deletion, and the
+    // GLX window has to go before the X window it wraps
+    lal_gl.glXMakeContextCurrent(window->display, None, None, NULL);
+    glXDestroyWindow(window->display, window->glx_id);
+    glXDestroyContext(window->display, window->context);
+
+    xcb_destroy_window(window->xcb_connection, window->xcb_id);
+    xcb_free_colormap(window->xcb_connection, window->xcb_colormap);
+
+    while((event = take_deferred_event(window)) != NULL)
+        free(event);
+
+    unregister_x_error_display(window->display);
+
+    XCloseDisplay(window->display);
+
+    input_shutdown();
+
+    lal_free(window, sizeof(WindowXCBGL));
+    platform_handler->window = NULL;
+}
+
+// Translates one XCB event, returns TRUE when it produced a LAL event
+static b8 translate_xcb_event(PlatformHandler *platform_handler, WindowXCBGL *window,
+        xcb_generic_event_t *event, LalEvent *out)
+{
+    xcb_client_message_event_t *client_msg;
+    xcb_key_press_event_t *kb_event;
+    xcb_button_press_event_t *button_event;
+    xcb_motion_notify_event_t *motion_event;
+    xcb_configure_notify_event_t *configure_event;
+    xcb_visibility_notify_event_t *visibility_event;
+    xcb_expose_event_t *expose_event;
+    xcb_selection_notify_event_t *selection_notify;
+    xcb_selection_request_event_t *selection_request;
+    xcb_property_notify_event_t *property_notify;
+    KeySym keysym = 0;
+
+    uchar8 type = event->response_type & ~0x80;
+
+    switch(type)
+    {
+        case 0:
+            record_xcb_error(platform_handler, (xcb_generic_error_t *)event);
+            return FALSE;
+        case XCB_MAP_NOTIFY:
+            platform_handler->mapped = TRUE;
+            return FALSE;
+        case XCB_UNMAP_NOTIFY:
+            platform_handler->mapped = FALSE;
+            return FALSE;
+        case XCB_VISIBILITY_NOTIFY:
+            visibility_event = (xcb_visibility_notify_event_t *)event;
+            platform_handler->obscured = visibility_event->state == XCB_VISIBILITY_FULLY_OBSCURED;
+            return FALSE;
+        case XCB_FOCUS_IN:
+        case XCB_FOCUS_OUT:
+            return translate_focus(platform_handler, type == XCB_FOCUS_IN, out);
+        case XCB_CONFIGURE_NOTIFY:
+            configure_event = (xcb_configure_notify_event_t *)event;
+            track_window_position(platform_handler, configure_event->x, configure_event->y,
+                (event->response_type & 0x80) != 0);
+            return translate_resize(platform_handler, configure_event->width, configure_event->height, out);
+        case XCB_EXPOSE:
+            expose_event = (xcb_expose_event_t *)event;
+            if(expose_event->count != 0)
+                return FALSE;
+            return translate_simple_event(platform_handler, LAL_EVENT_EXPOSE, out);
+        case XCB_CLIENT_MESSAGE:
+            client_msg = (xcb_client_message_event_t *)event;
+            if(client_msg->data.data32[0] != window->delete_msg)
+                return FALSE;
+            return translate_simple_event(platform_handler, LAL_EVENT_CLOSE, out);
+        case XCB_GE_GENERIC:
+            return translate_xi_wire_event(platform_handler, (xcb_ge_generic_event_t *)event, out);
+        case XCB_SELECTION_NOTIFY:
+            selection_notify = (xcb_selection_notify_event_t *)event;
+            handle_selection_notify(platform_handler, selection_notify->selection, selection_notify->property);
+            return FALSE;
+        case XCB_SELECTION_REQUEST:
+            selection_request = (xcb_selection_request_event_t *)event;
+            handle_selection_request(platform_handler, selection_request->requestor, selection_request->selection,
+                selection_request->target, selection_request->property, selection_request->time);
+            return FALSE;
+        case XCB_SELECTION_CLEAR:
+            handle_selection_clear(platform_handler, ((xcb_selection_clear_event_t *)event)->selection);
+            return FALSE;
+        case XCB_PROPERTY_NOTIFY:
+            property_notify = (xcb_property_notify_event_t *)event;
+            handle_property_notify(platform_handler, property_notify->window, property_notify->atom,
+                property_notify->state == XCB_PROPERTY_DELETE);
+            return FALSE;
+        case XCB_DESTROY_NOTIFY:
+            handle_destroy_notify(platform_handler, ((xcb_destroy_notify_event_t *)event)->window);
+            return FALSE;
+        case XCB_KEY_PRESS:
+        case XCB_KEY_RELEASE:
+            if(platform_handler->raw_keyboard)
+                return FALSE;
+
+            kb_event = (xcb_key_press_event_t *)event;
+            keysym = XkbKeycodeToKeysym(window->display, (KeyCode)kb_event->detail, 0, 0);
+            return translate_key(platform_handler, translate_keycode(keysym), type == XCB_KEY_PRESS,
+                kb_event->time, out);
+        case XCB_BUTTON_PRESS:
+        case XCB_BUTTON_RELEASE:
+            button_event = (xcb_button_press_event_t *)event;
+            return translate_button(platform_handler, button_event->detail, type == XCB_BUTTON_PRESS,
+                button_event->event_x, button_event->event_y, button_event->time, out);
+        case XCB_MOTION_NOTIFY:
+            motion_event = (xcb_motion_notify_event_t *)event;
+            return translate_motion(platform_handler, motion_event->event_x, motion_event->event_y,
+                motion_event->time, out);
+        default:
+            handle_monitor_event(platform_handler, type);
+            return FALSE;
+    }
+}
+
+void sync_xcb_errors(PlatformHandler *platform_handler)
+{
+    WindowXCBGL *window = (WindowXCBGL *)platform_handler->window;
+    xcb_generic_event_t *event;
+
+    // XSync also settles errors of the Xlib and GLX requests on this
+    // connection, XCB errors land in the event queue behind its reply
+    XSync(window->display, False);
+
+    // Pull the errors out and keep the events for the next poll
+    while(window->deferred_count < LAL_XCB_DEFERRED_EVENTS
+            && (event = xcb_poll_for_queued_event(window->xcb_connection)) != NULL)
+    {
+        if(event->response_type == 0)
+        {
+            record_xcb_error(platform_handler, (xcb_generic_error_t *)event);
+            free(event);
+            continue;
+        }
+
+        uint32 tail = (window->deferred_head + window->deferred_count) % LAL_XCB_DEFERRED_EVENTS;
+        window->deferred_events[tail] = event;
+        window->deferred_count++;
+    }
+}
+
+// TODO: Fix closing event when clicking on X button
+uint32 poll_xcb_events(PlatformHandler *platform_handler, LalEvent *events, uint32 capacity)
+{
+    WindowXCBGL *window = (WindowXCBGL *)platform_handler->window;
+    xcb_generic_event_t *event = NULL;
+    uint32 count = 0;
+
+#ifdef LAL_DEBUG_ZERO_ALLOC
+    lal_memory_check_frame(&window->frame_check, LAL_DEBUG_ZERO_ALLOC_WARMUP);
+#endif
+
+    sint32 timeout_ms = apply_idle_policy(platform_handler);
+
+    if(capacity == 0)
+        return 0;
+
+    // Read the connection once, then drain what that read already queued.
+    // Events that don't fit stay queued in XCB for the next call.
+    event = take_deferred_event(window);
+    if(event == NULL)
+        event = xcb_poll_for_event(window->xcb_connection);
+    if(event == NULL && timeout_ms != 0)
+    {
+        // Queue is empty, sleep on the socket instead of spinning
+        wait_for_connection(xcb_get_file_descriptor(window->xcb_connection), timeout_ms);
+        event = xcb_poll_for_event(window->xcb_connection);
+    }
+    else
+    {
+        dispatch_wait_sources();
+    }
+
+    while(event != NULL)
+    {
+        if(translate_xcb_event(platform_handler, window, event, &events[count]))
+        {
+            dispatch_event(platform_handler, &events[count]);
+            if(is_event_delivered(platform_handler, &events[count]))
+                count++;
+        }
+
+        // XCB allocates every event, hand it back right after translation
+        free(event);
+
+        if(count == capacity)
+            break;
+
+        event = take_deferred_event(window);
+        if(event == NULL)
+            event = xcb_poll_for_queued_event(window->xcb_connection);
+    }
+
+    // A full buffer leaves it owed to the next call
+    if(count < capacity && flush_monitor_event(platform_handler, &events[count]))
+        dispatch_event(platform_handler, &events[count++]);
+
+    count += poll_raw_keyboard_events(platform_handler, events + count, capacity - count);
+
+    input_publish();
+
+    return count;
+}
+
+void process_xcb_events(PlatformHandler *platform_handler)
+{
+    LalEvent events[LAL_XCB_EVENT_BATCH];
+
+    poll_xcb_events(platform_handler, events, LAL_XCB_EVENT_BATCH);
+}
+
+#endif // LPLATFORM_LINUX
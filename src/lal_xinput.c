@@ -0,0 +1,524 @@
+// XInput 2 and XFixes parts of the window backends: pointer lock and touch
+
+#include "lal_defines.h"
+#include "lal_error_list.h"
+#include "lal/lal_window.h"
+#include "lal/lal_log.h"
+#include "lal_window_internal.h"
+
+#if LPLATFORM_LINUX
+
+#include <X11/extensions/XInput2.h>
+#include <X11/extensions/Xfixes.h>
+
+// xXIRawEvent as XCB hands it out, full_sequence inserted after 32 bytes.
+// Followed by the valuator mask, the accelerated and the raw FP3232 values.
+typedef struct XIRawWireEvent
+{
+    uchar8 response_type;
+    uchar8 extension;
+    ushort16 sequence;
+    uint32 length;
+    ushort16 event_type;
+    ushort16 device_id;
+    uint32 time;
+    uint32 detail;
+    ushort16 source_id;
+    ushort16 valuators_len;
+    uint32 flags;
+    uint32 pad;
+    uint32 full_sequence;
+} XIRawWireEvent;
+
+// xXIDeviceEvent as XCB hands it out, for touch, key, button and motion
+typedef struct XIDeviceWireEvent
+{
+    uchar8 response_type;
+    uchar8 extension;
+    ushort16 sequence;
+    uint32 length;
+    ushort16 event_type;
+    ushort16 device_id;
+    uint32 time;
+    uint32 detail;
+    uint32 root;
+    uint32 event;
+    uint32 child;
+    uint32 full_sequence;
+    sint32 root_x;
+    sint32 root_y;
+    sint32 event_x;
+    sint32 event_y;
+    ushort16 buttons_len;
+    ushort16 valuators_len;
+    ushort16 source_id;
+    ushort16 pad;
+    uint32 flags;
+} XIDeviceWireEvent;
+
+// xXIHierarchyEvent as XCB hands it out, followed by num_info entries
+typedef struct XIHierarchyWireEvent
+{
+    uchar8 response_type;
+    uchar8 extension;
+    ushort16 sequence;
+    uint32 length;
+    ushort16 event_type;
+    ushort16 device_id;
+    uint32 time;
+    uint32 flags;
+    ushort16 num_info;
+    ushort16 pad[5];
+    uint32 full_sequence;
+} XIHierarchyWireEvent;
+
+typedef struct XIHierarchyWireInfo
+{
+    ushort16 device_id;
+    ushort16 attachment;
+    uchar8 use;
+    uchar8 enabled;
+    ushort16 pad;
+    uint32 flags;
+} XIHierarchyWireInfo;
+
+typedef struct FP3232
+{
+    sint32 integral;
+    uint32 fraction;
+} FP3232;
+
+enum
+{
+    BARRIER_TOP,
+    BARRIER_BOTTOM,
+    BARRIER_LEFT,
+    BARRIER_RIGHT
+};
+
+// Raw events need XInput 2.0 and touch 2.2, the opcode tells them apart from
+// other generic events. The version can only be announced once per display.
+static b8 query_xinput(PlatformHandler *platform_handler, Display *display)
+{
+    sint32 event_base;
+    sint32 error_base;
+    sint32 major = 2;
+    sint32 minor = 2;
+
+    if(platform_handler->xi_opcode >= 0)
+        return TRUE;
+
+    if(!XQueryExtension(display, "XInputExtension", &platform_handler->xi_opcode, &event_base, &error_base)
+            || XIQueryVersion(display, &major, &minor) != Success)
+    {
+        platform_handler->xi_opcode = -1;
+        return FALSE;
+    }
+
+    platform_handler->xi_minor = minor;
+    return TRUE;
+}
+
+// Raw events are only delivered to the root window
+static void select_raw_motion(Display *display, b8 enabled)
+{
+    uchar8 mask[XIMaskLen(XI_RawMotion)] = { 0 };
+    XIEventMask event_mask;
+
+    if(enabled)
+        XISetMask(mask, XI_RawMotion);
+
+    event_mask.deviceid = XIAllMasterDevices;
+    event_mask.mask_len = sizeof(mask);
+    event_mask.mask = mask;
+    XISelectEvents(display, DefaultRootWindow(display), &event_mask, 1);
+}
+
+static void destroy_pointer_barriers(PlatformHandler *platform_handler, Display *display)
+{
+    for(uint32 i = 0; i < LAL_POINTER_BARRIERS; i++)
+    {
+        if(platform_handler->pointer_barriers[i] != None)
+            XFixesDestroyPointerBarrier(display, platform_handler->pointer_barriers[i]);
+        platform_handler->pointer_barriers[i] = None;
+    }
+}
+
+// Barriers along the client area edges, each one lets the pointer move inwards only
+static void create_pointer_barriers(PlatformHandler *platform_handler, Display *display, ulong32 window)
+{
+    sint32 event_base;
+    sint32 error_base;
+    sint32 major = 5;
+    sint32 minor = 0;
+    sint32 x;
+    sint32 y;
+    Window child;
+
+    // Pointer barriers came with XFixes 5, the grab still confines without them
+    if(!XFixesQueryExtension(display, &event_base, &error_base)
+            || !XFixesQueryVersion(display, &major, &minor) || major < 5)
+        return;
+
+    if(!XTranslateCoordinates(display, window, DefaultRootWindow(display), 0, 0, &x, &y, &child))
+        return;
+
+    sint32 right = x + (sint32)platform_handler->width;
+    sint32 bottom = y + (sint32)platform_handler->height;
+    Window root = DefaultRootWindow(display);
+
+    platform_handler->pointer_barriers[BARRIER_TOP] =
+        XFixesCreatePointerBarrier(display, root, x, y, right, y, BarrierPositiveY, 0, NULL);
+    platform_handler->pointer_barriers[BARRIER_BOTTOM] =
+        XFixesCreatePointerBarrier(display, root, x, bottom, right, bottom, BarrierNegativeY, 0, NULL);
+    platform_handler->pointer_barriers[BARRIER_LEFT] =
+        XFixesCreatePointerBarrier(display, root, x, y, x, bottom, BarrierPositiveX, 0, NULL);
+    platform_handler->pointer_barriers[BARRIER_RIGHT] =
+        XFixesCreatePointerBarrier(display, root, right, y, right, bottom, BarrierNegativeX, 0, NULL);
+}
+
+static void acquire_pointer_lock(PlatformHandler *platform_handler)
+{
+    ulong32 window;
+    Display *display = get_x_window(platform_handler, &window);
+
+    uint32 grab_mask = ButtonPressMask | ButtonReleaseMask | PointerMotionMask;
+    if(XGrabPointer(display, window, True, grab_mask, GrabModeAsync, GrabModeAsync,
+            window, None, CurrentTime) != GrabSuccess)
+        LAL_WARN("Pointer grab failed, the pointer lock only confines through barriers.");
+
+    XFixesHideCursor(display, window);
+    select_raw_motion(display, TRUE);
+    create_pointer_barriers(platform_handler, display, window);
+    XFlush(display);
+
+    platform_handler->pointer_lock_active = TRUE;
+}
+
+static void release_pointer_lock(PlatformHandler *platform_handler)
+{
+    ulong32 window;
+    Display *display = get_x_window(platform_handler, &window);
+
+    XUngrabPointer(display, CurrentTime);
+    XFixesShowCursor(display, window);
+    select_raw_motion(display, FALSE);
+    destroy_pointer_barriers(platform_handler, display);
+    XFlush(display);
+
+    platform_handler->pointer_lock_active = FALSE;
+}
+
+b8 set_pointer_lock(PlatformHandler *platform_handler, b8 locked)
+{
+    ulong32 window;
+
+    if(platform_handler->pointer_locked == locked)
+        return OK;
+
+    if(locked && !query_xinput(platform_handler, get_x_window(platform_handler, &window)))
+    {
+        LAL_ERROR("Pointer lock needs XInput 2.");
+        return FAILED;
+    }
+
+    platform_handler->pointer_locked = locked;
+    update_pointer_lock(platform_handler);
+
+    return OK;
+}
+
+b8 is_pointer_locked(PlatformHandler *platform_handler)
+{
+    return platform_handler->pointer_locked;
+}
+
+void update_pointer_lock(PlatformHandler *platform_handler)
+{
+    b8 wanted = platform_handler->pointer_locked && platform_handler->focused;
+
+    if(wanted && !platform_handler->pointer_lock_active)
+        acquire_pointer_lock(platform_handler);
+    else if(!wanted && platform_handler->pointer_lock_active)
+        release_pointer_lock(platform_handler);
+}
+
+void move_pointer_barriers(PlatformHandler *platform_handler)
+{
+    ulong32 window;
+    Display *display = get_x_window(platform_handler, &window);
+
+    if(!platform_handler->pointer_lock_active)
+        return;
+
+    destroy_pointer_barriers(platform_handler, display);
+    create_pointer_barriers(platform_handler, display, window);
+    XFlush(display);
+}
+
+// Adds or refreshes one slave device of the per-device input table
+static void add_xi_device(Display *display, sint32 id)
+{
+    sint32 count;
+    XIDeviceInfo *info = XIQueryDevice(display, id, &count);
+    if(info == NULL)
+        return;
+
+    if(count > 0 && info->enabled)
+    {
+        if(info->use == XISlaveKeyboard)
+            input_add_device((uint32)id, INPUT_DEVICE_KEYBOARD, (uint32)info->attachment, info->name);
+        else if(info->use == XISlavePointer)
+            input_add_device((uint32)id, INPUT_DEVICE_POINTER, (uint32)info->attachment, info->name);
+        else if(info->use == XIFloatingSlave)
+            input_add_device((uint32)id, INPUT_DEVICE_POINTER, 0, info->name);
+    }
+
+    XIFreeDeviceInfo(info);
+}
+
+static void add_xi_devices(Display *display)
+{
+    sint32 count;
+    XIDeviceInfo *info = XIQueryDevice(display, XIAllDevices, &count);
+    if(info == NULL)
+        return;
+
+    for(sint32 i = 0; i < count; i++)
+    {
+        if(info[i].use == XISlaveKeyboard || info[i].use == XISlavePointer || info[i].use == XIFloatingSlave)
+            add_xi_device(display, info[i].deviceid);
+    }
+
+    XIFreeDeviceInfo(info);
+}
+
+static void remove_xi_devices()
+{
+    uint32 ids[LAL_MAX_INPUT_DEVICES];
+    uint32 count = get_input_devices(ids, LAL_MAX_INPUT_DEVICES);
+
+    for(uint32 i = 0; i < count; i++)
+        input_remove_device(ids[i]);
+}
+
+// One hierarchy change, only the name needs a round-trip
+static void apply_hierarchy_change(Display *display, sint32 id, uint32 flags)
+{
+    if(flags & (XISlaveRemoved | XIDeviceDisabled))
+        input_remove_device((uint32)id);
+    else if(flags != 0)
+        add_xi_device(display, id);
+}
+
+void select_xi_events(PlatformHandler *platform_handler)
+{
+    ulong32 window;
+    Display *display = get_x_window(platform_handler, &window);
+    uint32 features = platform_handler->input_features;
+    b8 per_device = (features & INPUT_FEATURE_PER_DEVICE) != 0;
+    uchar8 mask[XIMaskLen(XI_TouchEnd)] = { 0 };
+    uchar8 hierarchy_mask[XIMaskLen(XI_HierarchyChanged)] = { 0 };
+    XIEventMask event_mask;
+
+    if(!query_xinput(platform_handler, display))
+    {
+        if(features & (INPUT_FEATURE_TOUCH | INPUT_FEATURE_PER_DEVICE))
+            LAL_WARN("Touch and per-device input need XInput 2.");
+        return;
+    }
+
+    if((features & INPUT_FEATURE_TOUCH) && platform_handler->xi_minor < 2)
+        LAL_WARN("Touch input needs XInput 2.2.");
+    else if(features & INPUT_FEATURE_TOUCH)
+    {
+        XISetMask(mask, XI_TouchBegin);
+        XISetMask(mask, XI_TouchUpdate);
+        XISetMask(mask, XI_TouchEnd);
+    }
+
+    // XI2 selections replace the core ones for this client, keep the feature split
+    if(per_device && (features & INPUT_FEATURE_KEYBOARD))
+    {
+        XISetMask(mask, XI_KeyPress);
+        XISetMask(mask, XI_KeyRelease);
+    }
+    if(per_device && (features & INPUT_FEATURE_MOUSE_BUTTONS))
+    {
+        XISetMask(mask, XI_ButtonPress);
+        XISetMask(mask, XI_ButtonRelease);
+    }
+    if(per_device && (features & INPUT_FEATURE_MOUSE_MOTION))
+        XISetMask(mask, XI_Motion);
+
+    event_mask.deviceid = XIAllMasterDevices;
+    event_mask.mask_len = sizeof(mask);
+    event_mask.mask = mask;
+    XISelectEvents(display, window, &event_mask, 1);
+
+    // Hotplug, device state is allocated and freed as slaves come and go
+    if(per_device)
+        XISetMask(hierarchy_mask, XI_HierarchyChanged);
+
+    event_mask.deviceid = XIAllDevices;
+    event_mask.mask_len = sizeof(hierarchy_mask);
+    event_mask.mask = hierarchy_mask;
+    XISelectEvents(display, DefaultRootWindow(display), &event_mask, 1);
+
+    if(per_device)
+        add_xi_devices(display);
+    else
+        remove_xi_devices();
+
+    XFlush(display);
+}
+
+static LalEventType touch_event_type(sint32 xi_type)
+{
+    switch(xi_type)
+    {
+        case XI_TouchBegin: return LAL_EVENT_TOUCH_BEGIN;
+        case XI_TouchUpdate: return LAL_EVENT_TOUCH_UPDATE;
+        case XI_TouchEnd: return LAL_EVENT_TOUCH_END;
+        default: return LAL_EVENT_NONE;
+    }
+}
+
+// Key, button and motion events of INPUT_FEATURE_PER_DEVICE, tagged with the
+// slave device that produced them
+static b8 translate_device_event(PlatformHandler *platform_handler, Display *display, sint32 xi_type,
+        uint32 detail, uint32 source, sshort16 x, sshort16 y, uint32 time, LalEvent *out)
+{
+    KeySym keysym;
+
+    switch(xi_type)
+    {
+        case XI_KeyPress:
+        case XI_KeyRelease:
+            if(platform_handler->raw_keyboard)
+                return FALSE;
+
+            keysym = XkbKeycodeToKeysym(display, (KeyCode)detail, 0, 0);
+            if(!translate_key(platform_handler, translate_keycode((uint32)keysym), xi_type == XI_KeyPress, time, out))
+                return FALSE;
+            out->key.device = (ushort16)source;
+            return TRUE;
+        case XI_ButtonPress:
+        case XI_ButtonRelease:
+            if(!translate_button(platform_handler, detail, xi_type == XI_ButtonPress, x, y, time, out))
+                return FALSE;
+            if(out->type == LAL_EVENT_BUTTON)
+                out->button.device = (ushort16)source;
+            return TRUE;
+        case XI_Motion:
+            if(!translate_motion(platform_handler, x, y, time, out))
+                return FALSE;
+            out->motion.device = (ushort16)source;
+            return TRUE;
+        default:
+            return FALSE;
+    }
+}
+
+b8 translate_xi_event(PlatformHandler *platform_handler, Display *display, XGenericEventCookie *cookie,
+        LalEvent *out)
+{
+    b8 translated = FALSE;
+
+    if(cookie->extension != platform_handler->xi_opcode || !XGetEventData(display, cookie))
+        return FALSE;
+
+    if(cookie->evtype == XI_HierarchyChanged)
+    {
+        XIHierarchyEvent *hierarchy = (XIHierarchyEvent *)cookie->data;
+        for(sint32 i = 0; i < hierarchy->num_info; i++)
+            apply_hierarchy_change(display, hierarchy->info[i].deviceid, (uint32)hierarchy->info[i].flags);
+    }
+    else if(touch_event_type(cookie->evtype) != LAL_EVENT_NONE)
+    {
+        XIDeviceEvent *device_event = (XIDeviceEvent *)cookie->data;
+        translated = translate_touch(platform_handler, touch_event_type(cookie->evtype), (uint32)device_event->detail,
+            (sshort16)device_event->event_x, (sshort16)device_event->event_y, (uint32)device_event->time, out);
+    }
+    else if(cookie->evtype == XI_RawMotion)
+    {
+        XIRawEvent *raw = (XIRawEvent *)cookie->data;
+        d64 delta[2] = { 0.0, 0.0 };
+        const d64 *value = raw->raw_values;
+
+        for(sint32 i = 0; i < raw->valuators.mask_len * 8; i++)
+        {
+            if(!XIMaskIsSet(raw->valuators.mask, i))
+                continue;
+            if(i < 2)
+                delta[i] = *value;
+            value++;
+        }
+
+        translated = translate_relative_motion(platform_handler, (f32)delta[0], (f32)delta[1],
+            (uint32)raw->time, out);
+    }
+    else
+    {
+        XIDeviceEvent *device_event = (XIDeviceEvent *)cookie->data;
+        translated = translate_device_event(platform_handler, display, cookie->evtype, (uint32)device_event->detail,
+            (uint32)device_event->sourceid, (sshort16)device_event->event_x, (sshort16)device_event->event_y,
+            (uint32)device_event->time, out);
+    }
+
+    XFreeEventData(display, cookie);
+    return translated;
+}
+
+b8 translate_xi_wire_event(PlatformHandler *platform_handler, const xcb_ge_generic_event_t *event, LalEvent *out)
+{
+    const XIRawWireEvent *raw = (const XIRawWireEvent *)event;
+    const XIDeviceWireEvent *device_event = (const XIDeviceWireEvent *)event;
+    WindowXCBGL *window = (WindowXCBGL *)platform_handler->window;
+
+    if(raw->extension != platform_handler->xi_opcode)
+        return FALSE;
+
+    if(raw->event_type == XI_HierarchyChanged)
+    {
+        const XIHierarchyWireEvent *hierarchy = (const XIHierarchyWireEvent *)event;
+        const XIHierarchyWireInfo *info = (const XIHierarchyWireInfo *)(hierarchy + 1);
+        for(uint32 i = 0; i < hierarchy->num_info; i++)
+            apply_hierarchy_change(window->display, info[i].device_id, info[i].flags);
+        return FALSE;
+    }
+
+    // Positions are FP1616
+    if(touch_event_type(raw->event_type) != LAL_EVENT_NONE)
+        return translate_touch(platform_handler, touch_event_type(raw->event_type), device_event->detail,
+            (sshort16)(device_event->event_x >> 16), (sshort16)(device_event->event_y >> 16), device_event->time, out);
+
+    if(raw->event_type != XI_RawMotion)
+        return translate_device_event(platform_handler, window->display, raw->event_type, device_event->detail,
+            device_event->source_id, (sshort16)(device_event->event_x >> 16), (sshort16)(device_event->event_y >> 16),
+            device_event->time, out);
+
+    const uchar8 *mask = (const uchar8 *)(raw + 1);
+    uint32 mask_bits = raw->valuators_len * 32u;
+
+    uint32 count = 0;
+    for(uint32 i = 0; i < mask_bits; i++)
+        count += XIMaskIsSet(mask, i) ? 1 : 0;
+
+    // Skip the accelerated values, the raw ones follow them
+    const FP3232 *value = (const FP3232 *)(mask + raw->valuators_len * 4u) + count;
+    d64 delta[2] = { 0.0, 0.0 };
+
+    for(uint32 i = 0; i < mask_bits; i++)
+    {
+        if(!XIMaskIsSet(mask, i))
+            continue;
+        if(i < 2)
+            delta[i] = value->integral + value->fraction / 4294967296.0;
+        value++;
+    }
+
+    return translate_relative_motion(platform_handler, (f32)delta[0], (f32)delta[1], raw->time, out);
+}
+
+#endif // LPLATFORM_LINUX